@@ -0,0 +1,144 @@
+// Adaptive antialiasing for the 2D fragment shaders
+//
+// The shaders take one sample at each pixel centre and only output a colour,
+// so refinement is driven by the colour, which tracks the smooth iteration
+// count through the palette:
+//
+//   1. draw the shader once into baseTex
+//   2. copy it into the float accumulator, then mark in the stencil buffer the
+//      pixels whose colour differs from a 4-neighbour by more than the
+//      threshold (an occlusion query counts them)
+//   3. draw the shader samples-1 more times with uv shifted by a sub-pixel
+//      jitter (u_jitter), stencil-tested so unmarked pixels are never shaded,
+//      blending each sample into the running average with weight 1/(k+1)
+//
+// Jitter follows the R2 sequence, so any sample count covers the pixel evenly.
+// Nothing in the .frag files has to change.
+#include "fractal.h"
+#include "aa.h"
+#include <stdlib.h>
+
+static const char* edgeFragmentSource = R"(
+#version 330 core
+out vec4 FragColor;
+uniform sampler2D u_base;
+uniform int u_mode;         // 0: copy, 1: keep only pixels to refine
+uniform float u_threshold;
+float diff(ivec2 p, ivec2 m, vec3 c){
+    vec3 d = abs(texelFetch(u_base, clamp(p, ivec2(0), m), 0).rgb - c);
+    return max(d.r, max(d.g, d.b));
+}
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    vec3 c = texelFetch(u_base, p, 0).rgb;
+    if (u_mode == 1) {
+        ivec2 m = textureSize(u_base, 0) - 1;
+        float d = max(max(diff(p + ivec2(1, 0), m, c), diff(p - ivec2(1, 0), m, c)),
+                      max(diff(p + ivec2(0, 1), m, c), diff(p - ivec2(0, 1), m, c)));
+        if (d <= u_threshold) discard;
+    }
+    FragColor = vec4(c, 1.0);
+}
+)";
+
+int aaInit(AdaptiveAA* aa, int width, int height, GLuint vao){
+    aa->width=width; aa->height=height; aa->vao=vao;
+    glGenTextures(1,&aa->baseTex);
+    glBindTexture(GL_TEXTURE_2D,aa->baseTex);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA8,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,NULL);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+    glGenFramebuffers(1,&aa->baseFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER,aa->baseFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,aa->baseTex,0);
+
+    glGenTextures(1,&aa->accumTex);
+    glBindTexture(GL_TEXTURE_2D,aa->accumTex);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA16,width,height,0,GL_RGBA,GL_UNSIGNED_SHORT,NULL);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+    glGenRenderbuffers(1,&aa->stencil);
+    glBindRenderbuffer(GL_RENDERBUFFER,aa->stencil);
+    glRenderbufferStorage(GL_RENDERBUFFER,GL_DEPTH24_STENCIL8,width,height);
+    glGenFramebuffers(1,&aa->accumFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER,aa->accumFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,aa->accumTex,0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER,GL_DEPTH_STENCIL_ATTACHMENT,GL_RENDERBUFFER,aa->stencil);
+    int ok=glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+
+    aa->edgeProgram=createProgram(vertexShaderSource,edgeFragmentSource);
+    aa->locMode=glGetUniformLocation(aa->edgeProgram,"u_mode");
+    aa->locThreshold=glGetUniformLocation(aa->edgeProgram,"u_threshold");
+    glGenQueries(1,&aa->query);
+    return ok;
+}
+
+void aaFree(AdaptiveAA* aa){
+    glDeleteFramebuffers(1,&aa->baseFBO); glDeleteTextures(1,&aa->baseTex);
+    glDeleteFramebuffers(1,&aa->accumFBO); glDeleteTextures(1,&aa->accumTex);
+    glDeleteRenderbuffers(1,&aa->stencil);
+    glDeleteProgram(aa->edgeProgram);
+    glDeleteQueries(1,&aa->query);
+}
+
+double aaRender(AdaptiveAA* aa, GLuint program, int samples, float threshold){
+    GLint locJitter=glGetUniformLocation(program,"u_jitter");
+    glViewport(0,0,aa->width,aa->height);
+    glBindVertexArray(aa->vao);
+
+    // 1. one sample per pixel
+    glBindFramebuffer(GL_FRAMEBUFFER,aa->baseFBO);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(program);
+    glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+
+    // 2. copy, then mark the pixels to refine
+    glBindFramebuffer(GL_FRAMEBUFFER,aa->accumFBO);
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glUseProgram(aa->edgeProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D,aa->baseTex);
+    glUniform1f(aa->locThreshold,threshold);
+    glUniform1i(aa->locMode,0);
+    glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+    if(samples<2){ glUseProgram(program); return 0.0; }
+
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS,1,0xFF);
+    glStencilOp(GL_KEEP,GL_KEEP,GL_REPLACE);
+    glColorMask(GL_FALSE,GL_FALSE,GL_FALSE,GL_FALSE);
+    glUniform1i(aa->locMode,1);
+    glBeginQuery(GL_SAMPLES_PASSED,aa->query);
+    glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+    glEndQuery(GL_SAMPLES_PASSED);
+    glColorMask(GL_TRUE,GL_TRUE,GL_TRUE,GL_TRUE);
+
+    // 3. jittered samples into the running average of the marked pixels
+    glStencilFunc(GL_EQUAL,1,0xFF);
+    glStencilOp(GL_KEEP,GL_KEEP,GL_KEEP);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_CONSTANT_ALPHA,GL_ONE_MINUS_CONSTANT_ALPHA);
+    glUseProgram(program);
+    for(int k=1;k<samples;k++){
+        double jx=0.5+k*0.7548776662466927, jy=0.5+k*0.5698402909980532;
+        jx-=(int)jx; jy-=(int)jy;
+        glBlendColor(0.0f,0.0f,0.0f,1.0f/(k+1));
+        glUniform2f(locJitter,(float)((jx-0.5)/aa->width),(float)((jy-0.5)/aa->height));
+        glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+    }
+    glDisable(GL_BLEND);
+    glDisable(GL_STENCIL_TEST);
+    glUniform2f(locJitter,0.0f,0.0f);
+
+    GLuint refined=0;
+    glGetQueryObjectuiv(aa->query,GL_QUERY_RESULT,&refined);
+    return (double)refined/((double)aa->width*aa->height);
+}
+
+int aaSamplesFromEnv(void){
+    const char* s=getenv("FRACTAL_AA");
+    int n = s ? atoi(s) : 1;
+    return n>1 ? n : 1;
+}
@@ -0,0 +1,29 @@
+// Adaptive antialiasing for the 2D fragment shaders
+#ifndef AA_H
+#define AA_H
+
+#include "glad.h"
+
+#define AA_THRESHOLD 0.1f   // max channel difference to a neighbour that still counts as smooth
+
+typedef struct {
+    int width, height;
+    GLuint baseFBO, baseTex;        // one sample per pixel
+    GLuint accumFBO, accumTex;      // running average, RGBA16
+    GLuint stencil;                 // marks the pixels to refine
+    GLuint edgeProgram;
+    GLint locMode, locThreshold;
+    GLuint vao, query;
+} AdaptiveAA;
+
+int aaInit(AdaptiveAA* aa, int width, int height, GLuint vao);
+void aaFree(AdaptiveAA* aa);
+// Draws program (view already set) at one sample per pixel, then samples-1
+// ones jittered through the vertex shader's u_jitter only where a neighbour
+// differs by more than threshold. The result is left in aa->accumFBO; returns
+// the fraction of pixels refined.
+double aaRender(AdaptiveAA* aa, GLuint program, int samples, float threshold);
+// Samples per refined pixel from FRACTAL_AA; 1 (off) when unset
+int aaSamplesFromEnv(void);
+
+#endif
@@ -0,0 +1,203 @@
+// Multi-view atlas: many views of one or more shaders side by side in one image
+//
+//   fractal.exe atlas <out.png> <cell> <iterations> <shader.frag[@cx,cy,scale[,re,im]]>...
+//
+// e.g. burning_ship.frag tricorn.frag celtic_fractal.frag for a comparison, or
+// mandelbrot.frag@-0.75,0.1,0.02 mandelbrot.frag@-1.25,0.02,0.01 ... for a
+// sheet of viewpoints. Cells are cell x cell pixels, filled left to right in
+// ceil(sqrt(views)) columns.
+//
+// Each view's centre, scale and Julia c live in one uniform buffer (the Views
+// block below), and every distinct shader is compiled once and drawn with one
+// instanced call covering all of its views. The vertex shader applies the
+// view: it hands the fragment shader uv already mapped so that the Params
+// block's identity view (centre 0, scale 0.5) turns it into the view's point.
+// Julia shaders with an INSTANCE_PARAM variant take c per view as well.
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include "kernel.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_VIEWS 256       // u_view[] in atlasVertexSource
+#define VIEWS_BINDING 1     // next to PARAMS_BINDING
+
+static const char* atlasVertexSource = R"(
+#version 330 core
+layout(location=0) in vec2 aPos;
+layout(std140) uniform Views {
+    vec4 u_view[256];           // centre, scale, atlas cell
+    vec4 u_viewParam[256];      // Julia c, set
+};
+uniform int u_firstView, u_columns;
+uniform vec2 u_cell;            // in clip space
+out vec2 uv;
+flat out vec3 v_param;
+void main() {
+    vec4 v = u_view[u_firstView + gl_InstanceID];
+    int cell = int(v.w);
+    int col = cell % u_columns, row = cell / u_columns;
+    vec2 q = aPos*0.5 + 0.5;
+    uv = 0.5 + (q - 0.5)*v.z*2.0 + v.xy;
+    v_param = u_viewParam[u_firstView + gl_InstanceID].xyz;
+    gl_Position = vec4(-1.0 + (float(col) + q.x)*u_cell.x, 1.0 - (float(row) + 1.0 - q.y)*u_cell.y, 0.0, 1.0);
+}
+)";
+
+typedef struct {
+    char shader[MAX_PATH];
+    double cx, cy, scale;
+    int paramSet;
+    double re, im;
+} AtlasView;
+
+// "name.frag[@cx,cy,scale[,re,im]]"; 0 on a bad spec
+static int parseView(const char* spec, AtlasView* v){
+    const char* at=strchr(spec,'@');
+    size_t len = at ? (size_t)(at-spec) : strlen(spec);
+    if(len<6 || len>=MAX_PATH || strncmp(spec+len-5,".frag",5)!=0) return 0;
+    memcpy(v->shader,spec,len); v->shader[len]='\0';
+    const BuiltinKernel* k=findBuiltinKernel(v->shader);
+    v->cx = k && k->julia ? 0.0 : -0.5;
+    v->cy=0.0; v->scale=1.5; v->paramSet=0; v->re=v->im=0.0;
+    if(!at) return 1;
+    int n=sscanf(at+1,"%lf,%lf,%lf,%lf,%lf",&v->cx,&v->cy,&v->scale,&v->re,&v->im);
+    v->paramSet = n==5;
+    return (n==3 || n==5) && v->scale>0.0;
+}
+
+int atlasMain(int argc, char** argv){
+    if(argc<4){
+        printf("usage: fractal.exe atlas <out.png> <cell> <iterations> <shader.frag[@cx,cy,scale[,re,im]]>...\n");
+        return 1;
+    }
+    const char* out=argv[0];
+    int cellSize=atoi(argv[1]);
+    int iterations=atoi(argv[2]);
+    int count=argc-3;
+    if(cellSize<1 || iterations<1 || count>MAX_VIEWS){
+        fprintf(stderr,"atlas: bad arguments (at most %d views)\n",MAX_VIEWS);
+        return 1;
+    }
+    AtlasView* views=(AtlasView*)calloc(count,sizeof(AtlasView));
+    for(int i=0;i<count;i++){
+        if(!parseView(argv[3+i],&views[i])){
+            fprintf(stderr,"atlas: bad view \"%s\"\n",argv[3+i]);
+            free(views);
+            return 1;
+        }
+    }
+    int columns=(int)ceil(sqrt((double)count));
+    int rows=(count+columns-1)/columns;
+    int width=columns*cellSize, height=rows*cellSize;
+
+    GLWindow win;
+    createGLWindow(&win,"Fractal atlas",0);
+    ParamsBuffer pb;
+    paramsInit(&pb);
+    ShaderParams sp;
+    memset(&sp,0,sizeof(sp));
+    sp.scale=0.5f;
+    sp.maxIter=iterations;
+    paramsUpdate(&pb,&sp);
+
+    // views grouped by shader so each program draws one contiguous range
+    static float viewData[2][MAX_VIEWS][4];
+    int* order=(int*)malloc(count*sizeof(int));
+    int* first=(int*)malloc(count*sizeof(int));     // per program
+    int* used=(int*)calloc(count,sizeof(int));
+    int programs=0, placed=0;
+    for(int i=0;i<count;i++){
+        if(used[i]) continue;
+        first[programs++]=placed;
+        for(int j=i;j<count;j++){
+            if(used[j] || strcmp(views[j].shader,views[i].shader)!=0) continue;
+            used[j]=1;
+            float* v=viewData[0][placed];
+            float* p=viewData[1][placed];
+            v[0]=(float)views[j].cx; v[1]=(float)views[j].cy; v[2]=(float)views[j].scale; v[3]=(float)j;
+            p[0]=(float)views[j].re; p[1]=(float)views[j].im; p[2]=(float)views[j].paramSet; p[3]=0.0f;
+            order[placed++]=j;
+        }
+    }
+    GLuint viewUBO;
+    glGenBuffers(1,&viewUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER,viewUBO);
+    glBufferData(GL_UNIFORM_BUFFER,sizeof(viewData),viewData,GL_STATIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER,VIEWS_BINDING,viewUBO);
+
+    GLuint fbo, color, vao=createQuad();
+    glGenTextures(1,&color);
+    glBindTexture(GL_TEXTURE_2D,color);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA8,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,NULL);
+    glGenFramebuffers(1,&fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER,fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,color,0);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE)
+        fatalError("Fractal atlas","The atlas is larger than the GL framebuffer limit; use a smaller cell");
+    glViewport(0,0,width,height);
+    glClearColor(0.0f,0.0f,0.0f,1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindVertexArray(vao);
+
+    int ok=1;
+    double seconds=0.0;
+    for(int k=0;k<programs && ok;k++){
+        int start=first[k], end = k+1<programs ? first[k+1] : count;
+        const char* name=views[order[start]].shader;
+        char* src=tryLoadFile(name);
+        if(!src){ fprintf(stderr,"atlas: cannot read %s\n",name); ok=0; break; }
+        if(strstr(src,"INSTANCE_PARAM")){
+            char* instanced=shaderWithDefine(src,"INSTANCE_PARAM");
+            free(src);
+            src=instanced;
+        }
+        char log[1024];
+        GLuint program=tryCreateProgram(atlasVertexSource,src,log,sizeof(log));
+        free(src);
+        if(!program){ fprintf(stderr,"%s: %s\n",name,log); ok=0; break; }
+        if(!paramsAttach(program)){
+            fprintf(stderr,"atlas: %s declares no Params block (see fractal.h)\n",name);
+            glDeleteProgram(program);
+            ok=0; break;
+        }
+        glUniformBlockBinding(program,glGetUniformBlockIndex(program,"Views"),VIEWS_BINDING);
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program,"u_firstView"),start);
+        glUniform1i(glGetUniformLocation(program,"u_columns"),columns);
+        glUniform2f(glGetUniformLocation(program,"u_cell"),2.0f/columns,2.0f/rows);
+
+        double t0=nowSeconds();
+        glDrawElementsInstanced(GL_TRIANGLES,6,GL_UNSIGNED_INT,0,end-start);
+        glFinish();
+        seconds+=nowSeconds()-t0;
+        glDeleteProgram(program);
+    }
+
+    unsigned char* rgb=NULL;
+    if(ok){
+        printf("%d views of %dx%d from %d shaders in %d draws, %.1f ms\n",count,cellSize,cellSize,programs,programs,seconds*1000.0);
+        rgb=(unsigned char*)malloc((size_t)width*height*3);
+        // GL rows are bottom-up
+        glPixelStorei(GL_PACK_ALIGNMENT,1);
+        glReadPixels(0,0,width,height,GL_RGB,GL_UNSIGNED_BYTE,rgb);
+        unsigned char* row=(unsigned char*)malloc((size_t)width*3);
+        for(int y=0;y<height/2;y++){
+            unsigned char* a=rgb+(size_t)y*width*3;
+            unsigned char* b=rgb+(size_t)(height-1-y)*width*3;
+            memcpy(row,a,(size_t)width*3); memcpy(a,b,(size_t)width*3); memcpy(b,row,(size_t)width*3);
+        }
+        free(row);
+        ok=writePNG(out,rgb,width,height);
+        if(!ok) fprintf(stderr,"atlas: cannot write %s\n",out);
+    }
+
+    free(rgb); free(views); free(order); free(first); free(used);
+    glDeleteFramebuffers(1,&fbo); glDeleteTextures(1,&color); glDeleteBuffers(1,&viewUBO);
+    paramsFree(&pb);
+    destroyGLWindow(&win);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,223 @@
+// Buddhabrot / Nebulabrot: orbit-density rendering of mandelbrot.frag's iteration
+//
+//   fractal.exe buddha <out.png> [WxH] [samples in millions] [bands] [cx cy scale]
+//   bands: comma separated iteration limits for R,G,B, e.g. 5000,500,50
+//          (a single value renders a grey Buddhabrot)
+//
+// Every worker runs its own Metropolis-Hastings chain over c. Proposals are
+// either a small gaussian step or a fresh uniform sample, and the target density
+// is the number of orbit points landing in the view, so zoomed-in renders spend
+// their time on orbits that matter. Orbits are splatted with weight
+// 1/contribution to keep the estimate unbiased. Workers write private
+// histograms; the final merge sums disjoint row ranges, so nothing is locked.
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_BANDS 3
+#define GLOBAL_PROPOSAL 0.2
+
+typedef struct {
+    int width, height;
+    double x0, y0, pixel;       // top-left corner and pixel size in the complex plane
+    int bands[MAX_BANDS], bandCount, maxIter;
+    long long samplesPerWorker;
+    int workers;
+    float** hist;               // per worker: bandCount planes of width*height
+    volatile int nextRow;
+    volatile int chains;        // workers that found an orbit through the view
+} Buddha;
+
+// --- Random numbers (splitmix64) ---
+static unsigned long long rngNext(unsigned long long* s){
+    unsigned long long z=(*s+=0x9E3779B97F4A7C15ull);
+    z=(z^(z>>30))*0xBF58476D1CE4E5B9ull;
+    z=(z^(z>>27))*0x94D049BB133111EBull;
+    return z^(z>>31);
+}
+
+static double rngUniform(unsigned long long* s){
+    return (rngNext(s)>>11)*(1.0/9007199254740992.0);
+}
+
+static double rngGauss(unsigned long long* s){
+    double u=rngUniform(s)+1e-300, v=rngUniform(s);
+    return sqrt(-2.0*log(u))*cos(6.283185307179586*v);
+}
+
+// Iterates z=z^2+c from 0, recording in-view pixel indices of the orbit.
+// Returns how many points were recorded if the orbit escapes, 0 otherwise.
+static int traceOrbit(const Buddha* b, double cr, double ci, int* points, int* escapeIter){
+    // main cardioid and period-2 bulb never escape
+    double q=(cr-0.25)*(cr-0.25)+ci*ci;
+    if(q*(q+(cr-0.25))<0.25*ci*ci || (cr+1.0)*(cr+1.0)+ci*ci<0.0625) return 0;
+
+    double zr=0.0, zi=0.0, inv=1.0/b->pixel;
+    int n=0, i;
+    for(i=0;i<b->maxIter;i++){
+        double t=zr*zr-zi*zi+cr;
+        zi=2.0*zr*zi+ci; zr=t;
+        if(zr*zr+zi*zi>4.0) break;
+        int px=(int)floor((zr-b->x0)*inv), py=(int)floor((b->y0-zi)*inv);
+        if(px>=0 && py>=0 && px<b->width && py<b->height) points[n++]=py*b->width+px;
+    }
+    if(i==b->maxIter) return 0;
+    *escapeIter=i+1;
+    return n;
+}
+
+static void buddhaWorker(void* ctx, int worker){
+    Buddha* b=(Buddha*)ctx;
+    size_t plane=(size_t)b->width*b->height;
+    float* hist=(float*)calloc(plane*b->bandCount,sizeof(float));
+    int* cur=(int*)malloc(b->maxIter*sizeof(int));
+    int* prop=(int*)malloc(b->maxIter*sizeof(int));
+    b->hist[worker]=hist;
+    if(!hist || !cur || !prop){ fprintf(stderr,"buddha: out of memory\n"); free(cur); free(prop); return; }
+
+    unsigned long long rng=0x853C49E6748FEA9Bull*(worker+1);
+    double cr=0.0, ci=0.0;
+    int curN=0, curIter=0;
+    for(int tries=0; tries<1000000 && !curN; tries++){
+        cr=-2.0+4.0*rngUniform(&rng); ci=-2.0+4.0*rngUniform(&rng);
+        curN=traceOrbit(b,cr,ci,cur,&curIter);
+    }
+    if(!curN){ free(cur); free(prop); return; }
+    atomicFetchAdd(&b->chains,1);
+
+    // mutation radius is log-uniform between one pixel and a tenth of the view
+    double minR=b->pixel, logSpan=log(b->height*0.1);
+    long long step=b->samplesPerWorker/100;
+    for(long long s=0;s<b->samplesPerWorker;s++){
+        double nr, ni;
+        if(rngUniform(&rng)<GLOBAL_PROPOSAL){
+            nr=-2.0+4.0*rngUniform(&rng); ni=-2.0+4.0*rngUniform(&rng);
+        } else {
+            double r=minR*exp(logSpan*rngUniform(&rng));
+            nr=cr+r*rngGauss(&rng); ni=ci+r*rngGauss(&rng);
+        }
+        int propIter, n=traceOrbit(b,nr,ni,prop,&propIter);
+        if(n>0 && rngUniform(&rng)*curN<n){
+            int* t=cur; cur=prop; prop=t;
+            curN=n; curIter=propIter; cr=nr; ci=ni;
+        }
+
+        float w=1.0f/curN;
+        for(int k=0;k<b->bandCount;k++){
+            if(curIter>b->bands[k]) continue;
+            float* h=hist+k*plane;
+            for(int p=0;p<curN;p++) h[cur[p]]+=w;
+        }
+
+        if(worker==0 && step && s%step==0){ printf("\r%3d%%",(int)(s/step)); fflush(stdout); }
+    }
+    free(cur); free(prop);
+}
+
+// Sums every worker histogram into worker 0's, 16 rows per grab
+static void mergeWorker(void* ctx, int worker){
+    Buddha* b=(Buddha*)ctx;
+    size_t plane=(size_t)b->width*b->height;
+    for(;;){
+        int row=atomicFetchAdd(&b->nextRow,16);
+        if(row>=b->height) return;
+        int rows = row+16<=b->height ? 16 : b->height-row;
+        for(int k=0;k<b->bandCount;k++){
+            float* dst=b->hist[0]+k*plane+(size_t)row*b->width;
+            for(int t=1;t<b->workers;t++){
+                if(!b->hist[t]) continue;
+                const float* src=b->hist[t]+k*plane+(size_t)row*b->width;
+                for(size_t i=0;i<(size_t)rows*b->width;i++) dst[i]+=src[i];
+            }
+        }
+    }
+}
+
+static int compareFloat(const void* a, const void* b){
+    float x=*(const float*)a, y=*(const float*)b;
+    return (x>y)-(x<y);
+}
+
+// Level that 99.9% of lit pixels stay under, so a few hot spots don't darken the rest
+static float brightLevel(const float* h, size_t n){
+    size_t stride=n/1000000+1, count=0;
+    float* vals=(float*)malloc((n/stride+1)*sizeof(float));
+    for(size_t i=0;i<n;i+=stride) if(h[i]>0.0f) vals[count++]=h[i];
+    float level=0.0f;
+    if(count){
+        qsort(vals,count,sizeof(float),compareFloat);
+        level=vals[(size_t)(count*0.999)];
+    }
+    free(vals);
+    return level>0.0f ? level : 1.0f;
+}
+
+int buddhabrotMain(int argc, char** argv){
+    if(argc<1){
+        printf("usage: fractal.exe buddha <out.png> [WxH] [samples in millions] [bands] [cx cy scale]\n");
+        return 1;
+    }
+    Buddha b={0};
+    const char* out=argv[0];
+    b.width=1024; b.height=1024;
+    double samplesM=20.0, vcx=-0.5, vcy=0.0, vscale=1.5;
+    if(argc>1) sscanf(argv[1],"%dx%d",&b.width,&b.height);
+    if(argc>2) samplesM=atof(argv[2]);
+    const char* bands = argc>3 ? argv[3] : "5000,500,50";
+    if(argc>6){ vcx=atof(argv[4]); vcy=atof(argv[5]); vscale=atof(argv[6]); }
+
+    for(const char* p=bands; *p && b.bandCount<MAX_BANDS; ){
+        int v=atoi(p);
+        if(v>0){ b.bands[b.bandCount++]=v; if(v>b.maxIter) b.maxIter=v; }
+        p=strchr(p,','); if(!p) break; p++;
+    }
+    if(!b.bandCount || b.width<1 || b.height<1){ fprintf(stderr,"buddha: bad arguments\n"); return 1; }
+
+    // square pixels; scale is the half-height of the view like u_scale
+    b.pixel=2.0*vscale/b.height;
+    b.x0=vcx-b.pixel*b.width*0.5;
+    b.y0=vcy+vscale;
+    b.workers=cpuCount();
+    b.samplesPerWorker=(long long)(samplesM*1e6/b.workers)+1;
+    b.hist=(float**)calloc(b.workers,sizeof(float*));
+
+    printf("Buddhabrot %dx%d, %.1fM samples on %d threads, bands",b.width,b.height,samplesM,b.workers);
+    for(int k=0;k<b.bandCount;k++) printf(" %d",b.bands[k]);
+    printf("\n");
+
+    double t0=nowSeconds();
+    runWorkers(b.workers,buddhaWorker,&b);
+    int failed = !b.hist[0] || !b.chains;
+    if(!b.chains) fprintf(stderr,"\nbuddha: no orbit reaches the view\n");
+    if(failed){
+        for(int t=0;t<b.workers;t++) free(b.hist[t]);
+        free(b.hist);
+        return 1;
+    }
+    runWorkers(b.workers,mergeWorker,&b);
+    double dt=nowSeconds()-t0;
+    printf("\r%.2fs, %.2fM samples/s\n",dt,samplesM/dt);
+
+    size_t plane=(size_t)b.width*b.height;
+    unsigned char* rgb=(unsigned char*)malloc(plane*3);
+    for(int ch=0;ch<3;ch++){
+        int k = b.bandCount==1 ? 0 : ch;
+        if(k>=b.bandCount){ for(size_t i=0;i<plane;i++) rgb[i*3+ch]=0; continue; }
+        const float* h=b.hist[0]+k*plane;
+        float inv=1.0f/brightLevel(h,plane);
+        for(size_t i=0;i<plane;i++){
+            float v=h[i]*inv; if(v>1.0f) v=1.0f;
+            rgb[i*3+ch]=(unsigned char)(sqrtf(v)*255.0f+0.5f);
+        }
+    }
+    int ok=writePNG(out,rgb,b.width,b.height);
+    if(!ok) fprintf(stderr,"buddha: cannot write %s\n",out);
+
+    for(int t=0;t<b.workers;t++) free(b.hist[t]);
+    free(b.hist); free(rgb);
+    return ok ? 0 : 1;
+}
@@ -1 +1,2 @@
-gcc fractal.c glad.c -o fractal.exe -lopengl32 -lgdi32 -lmpfr -lgmp
+@rem -Wno-psabi quiets the note on 32-byte simd.h vectors without -mavx (see simd.h)
+gcc -O2 -Wno-psabi fractal.c glad.c image.c tile_server.c buddhabrot.c escape.c raymarch.c kernel.c formula.c specialized.c jit.c orbit.c deep.c nucleus.c iterdata.c poster.c aa.c histogram.c explorer.c atlas.c compute.c -o fractal.exe -lopengl32 -lgdi32 -lws2_32 -lmpfr -lgmp
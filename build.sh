@@ -0,0 +1,5 @@
+#!/bin/sh
+# Linux/BSD build: GLFW window (X11 or Wayland) on Mesa or any GL 3.3 driver
+# -Wno-psabi: simd.h packets are 32 bytes, and without -mavx GCC notes an ABI
+# change for passing them by value; they never cross a translation unit
+gcc -O2 -Wno-psabi fractal.c glad.c image.c tile_server.c buddhabrot.c escape.c raymarch.c kernel.c formula.c specialized.c jit.c orbit.c deep.c nucleus.c iterdata.c poster.c aa.c histogram.c explorer.c atlas.c compute.c -o fractal -lglfw -lmpfr -lgmp -lpthread -ldl -lm
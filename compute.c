@@ -0,0 +1,237 @@
+// Compute-shader Mandelbrot with iteration chunks and queue compaction (GL 4.3)
+//
+//   fractal.exe compute <out.png> [WxH] [iterations] [cx cy scale] [chunk]
+//
+// A fragment shader keeps every pixel of a warp iterating until its slowest
+// one escapes, so a warp straddling the boundary pays for the interior. Here
+// the escape loop runs at most `chunk` iterations per dispatch:
+//
+//   1. each invocation takes one pixel from the input queue, restores its z
+//      and iteration count, and iterates up to chunk more times
+//   2. pixels that escaped or hit the limit store their smooth iteration
+//      count; the rest are appended to the output queue (one atomicAdd per
+//      workgroup, survivors packed through shared memory)
+//   3. a one-invocation pass turns the output count into the next indirect
+//      dispatch size and empties the other queue; the queues swap
+//
+// so each chunk only launches the pixels still running, in dense workgroups.
+// The CPU never waits on a count except every COMPUTE_POLL chunks, to stop
+// once the queue is empty. The first chunk takes every pixel without a queue.
+// View and iterations come from the Params block (fractal.h), coloring is
+// mandelbrot.frag's palette. chunk >= iterations gives the one-pass baseline.
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include "kernel.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COMPUTE_GROUP 64    // local_size_x of both shaders below
+#define COMPUTE_POLL 4      // chunks between reads of the queue length
+
+static const char* chunkSource = R"(
+#version 430 core
+layout(local_size_x = 64) in;
+layout(std140) uniform Params {
+    vec2 u_center; float u_scale; int u_maxIter;
+    vec2 u_param; int u_paramSet; int u_deMode; int u_histogram;
+};
+struct Pixel { vec2 z; int iter; float mu; };
+layout(std430, binding = 0) buffer Pixels { Pixel pixels[]; };
+layout(std430, binding = 1) readonly buffer QueueIn { uint queueIn[]; };
+layout(std430, binding = 2) writeonly buffer QueueOut { uint queueOut[]; };
+layout(std430, binding = 3) buffer Counts { uint groups[3]; uint count[2]; };
+uniform ivec2 u_size;
+uniform int u_chunk;
+uniform int u_first;        // 1: every pixel, from z = 0, no input queue
+uniform int u_in;           // count[u_in] sizes the input queue
+
+shared uint groupCount, groupBase;
+
+void main() {
+    if (gl_LocalInvocationIndex == 0u) groupCount = 0u;
+    barrier();
+
+    uint n = u_first != 0 ? uint(u_size.x*u_size.y) : count[u_in];
+    uint i = gl_GlobalInvocationID.x;
+    bool running = false;
+    uint p = 0u, slot = 0u;
+    if (i < n) {
+        p = u_first != 0 ? i : queueIn[i];
+        vec2 pos = vec2(float(p % uint(u_size.x)), float(p / uint(u_size.x))) + 0.5 - 0.5*vec2(u_size);
+        vec2 c = vec2(pos.x, -pos.y)/float(u_size.y)*u_scale*2.0 + u_center;   // row 0 on top
+        vec2 z = vec2(0.0);
+        int it = 0;
+        if (u_first == 0) { z = pixels[p].z; it = pixels[p].iter; }
+        int end = min(it + u_chunk, u_maxIter);
+        bool escaped = false;
+        for (; it < end; it++) {
+            z = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
+            if (dot(z, z) > 4.0) { escaped = true; break; }
+        }
+        if (escaped) pixels[p].mu = float(it) + 1.0 - log(log(length(z)))/log(2.0);
+        else if (it >= u_maxIter) pixels[p].mu = -1.0;
+        else {
+            pixels[p].z = z; pixels[p].iter = it;
+            running = true;
+            slot = atomicAdd(groupCount, 1u);
+        }
+    }
+
+    barrier();
+    if (gl_LocalInvocationIndex == 0u && groupCount > 0u) groupBase = atomicAdd(count[1 - u_in], groupCount);
+    barrier();
+    if (running) queueOut[groupBase + slot] = p;
+}
+)";
+
+static const char* prepareSource = R"(
+#version 430 core
+layout(local_size_x = 1) in;
+layout(std430, binding = 3) buffer Counts { uint groups[3]; uint count[2]; };
+uniform int u_in;           // the queue just written is count[1 - u_in]
+void main() {
+    groups[0] = (count[1 - u_in] + 63u)/64u;
+    groups[1] = 1u; groups[2] = 1u;
+    count[u_in] = 0u;
+}
+)";
+
+static GLuint computeProgram(const char* src){
+    GLuint cs=compileShader(GL_COMPUTE_SHADER,src);
+    GLuint prog=glCreateProgram();
+    glAttachShader(prog,cs);
+    glLinkProgram(prog);
+    GLint ok; glGetProgramiv(prog,GL_LINK_STATUS,&ok);
+    if(!ok){ char log[1024]; glGetProgramInfoLog(prog,1024,NULL,log); fatalError("Link error",log);}
+    glDeleteShader(cs);
+    return prog;
+}
+
+int computeMain(int argc, char** argv){
+    if(argc<1){
+        printf("usage: fractal.exe compute <out.png> [WxH] [iterations] [cx cy scale] [chunk]\n");
+        return 1;
+    }
+    const char* out=argv[0];
+    int w=1920, h=1080;
+    if(argc>1 && sscanf(argv[1],"%dx%d",&w,&h)!=2) w=0;
+    int iterations = argc>2 ? atoi(argv[2]) : 1000;
+    double vcx=-0.5, vcy=0.0, vscale=1.5;
+    if(argc>5){ vcx=atof(argv[3]); vcy=atof(argv[4]); vscale=atof(argv[5]); }
+    int chunk = argc>6 ? atoi(argv[6]) : 64;
+    if(w<1 || h<1 || iterations<1 || vscale<=0.0 || chunk<1){
+        fprintf(stderr,"compute: bad arguments\n");
+        return 1;
+    }
+
+    GLWindow win;
+    createGLWindow(&win,"Fractal compute",0);
+    if(!GLAD_GL_VERSION_4_3){
+        fprintf(stderr,"compute: needs OpenGL 4.3 compute shaders, the driver offers %d.%d\n",GLVersion.major,GLVersion.minor);
+        destroyGLWindow(&win);
+        return 1;
+    }
+    GLuint chunkProgram=computeProgram(chunkSource);
+    GLuint prepareProgram=computeProgram(prepareSource);
+    paramsAttach(chunkProgram);
+    ParamsBuffer pb;
+    paramsInit(&pb);
+    ShaderParams sp;
+    memset(&sp,0,sizeof(sp));
+    sp.center[0]=(float)vcx; sp.center[1]=(float)vcy;
+    sp.scale=(float)vscale;
+    sp.maxIter=iterations;
+    paramsUpdate(&pb,&sp);
+
+    // pixel state (z, iter, mu), two queues of pixel indices, and the counts
+    // with the indirect dispatch size in front
+    size_t pixelCount=(size_t)w*h;
+    GLuint pixels, queues[2], counts;
+    glGenBuffers(1,&pixels);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER,pixels);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,pixelCount*16,NULL,GL_DYNAMIC_COPY);
+    glGenBuffers(2,queues);
+    for(int k=0;k<2;k++){
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER,queues[k]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER,pixelCount*4,NULL,GL_DYNAMIC_COPY);
+    }
+    GLuint zero[5]={0,1,1,0,0};
+    glGenBuffers(1,&counts);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER,counts);
+    glBufferData(GL_SHADER_STORAGE_BUFFER,sizeof(zero),zero,GL_DYNAMIC_COPY);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER,0,pixels);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER,3,counts);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER,counts);
+
+    glUseProgram(chunkProgram);
+    glUniform2i(glGetUniformLocation(chunkProgram,"u_size"),w,h);
+    glUniform1i(glGetUniformLocation(chunkProgram,"u_chunk"),chunk);
+    GLint locFirst=glGetUniformLocation(chunkProgram,"u_first");
+    GLint locIn=glGetUniformLocation(chunkProgram,"u_in");
+    GLint locPrepareIn=glGetUniformLocation(prepareProgram,"u_in");
+
+    int chunks=(iterations+chunk-1)/chunk, ran=0, in=0;
+    double launched=0.0;                // pixel-chunks, from the polled counts
+    unsigned int active=(unsigned int)pixelCount;
+    printf("active pixels:");
+    double t0=nowSeconds();
+    for(int k=0;k<chunks;k++){
+        glUseProgram(chunkProgram);
+        glUniform1i(locFirst,k==0);
+        glUniform1i(locIn,in);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER,1,queues[in]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER,2,queues[1-in]);
+        if(k==0) glDispatchCompute((GLuint)((pixelCount+COMPUTE_GROUP-1)/COMPUTE_GROUP),1,1);
+        else glDispatchComputeIndirect(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(prepareProgram);
+        glUniform1i(locPrepareIn,in);
+        glDispatchCompute(1,1,1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT|GL_COMMAND_BARRIER_BIT);
+        in=1-in;
+        ran++;
+
+        if((k+1)%COMPUTE_POLL==0 || k+1==chunks){
+            // launched so far is only known at the polls; count the chunks
+            // since the last one at the size they started with
+            unsigned int now;
+            glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);     // shader writes, then a CPU read
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER,counts);
+            glGetBufferSubData(GL_SHADER_STORAGE_BUFFER,(3+in)*sizeof(GLuint),sizeof(now),&now);
+            launched+=(double)active*((k%COMPUTE_POLL)+1);
+            active=now;
+            printf(" %u",now);
+            fflush(stdout);
+            if(now==0) break;
+        }
+    }
+    glFinish();
+    double seconds=nowSeconds()-t0;
+    printf("\n%dx%d, %d iterations in %d chunks of %d: %.1f ms\n",w,h,iterations,ran,chunk,seconds*1000.0);
+    printf("at most %.1f%% of the pixel-chunks a lockstep pass would run\n",100.0*launched/((double)pixelCount*chunks));
+
+    // mu per pixel, coloured like mandelbrot.frag
+    float* state=(float*)malloc(pixelCount*16);
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER,pixels);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER,0,pixelCount*16,state);
+    unsigned char* rgb=(unsigned char*)malloc(pixelCount*3);
+    for(size_t i=0;i<pixelCount;i++){
+        float mu=state[i*4+3];
+        if(mu<0.0f) rgb[i*3]=rgb[i*3+1]=rgb[i*3+2]=0;
+        else paletteRGB(mu/iterations,rgb+i*3);
+    }
+    int ok=writePNG(out,rgb,w,h);
+    if(!ok) fprintf(stderr,"compute: cannot write %s\n",out);
+
+    free(state); free(rgb);
+    glDeleteBuffers(1,&pixels); glDeleteBuffers(2,queues); glDeleteBuffers(1,&counts);
+    glDeleteProgram(chunkProgram); glDeleteProgram(prepareProgram);
+    paramsFree(&pb);
+    destroyGLWindow(&win);
+    return ok ? 0 : 1;
+}
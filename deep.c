@@ -0,0 +1,496 @@
+// Deep zoom still renderer: perturbation with extended-range deltas
+//
+//   fractal.exe deep <out.png|out.fit> <re> <im> <radius> [WxH] [iterations] [orbit checkpoint]
+//
+// A .fit output keeps the smooth iteration counts (iterdata.h) for recoloring
+// instead of a coloured image.
+//
+// re, im and radius are decimal strings of any length; radius is the
+// half-height of the view like u_scale. One reference orbit Z at the centre is
+// computed with MPFR at just enough precision for the pixel spacing, and each
+// pixel only iterates its difference from it in doubles:
+//
+//   dz' = (2Z + dz) dz + dc
+//
+// Once the pixel spacing reaches 2^FE_PIXEL_EXP (about 1e-270), the pixel
+// offsets dc are close to the bottom of double range. They are kept as
+// floatexp, and each pixel runs the full iteration in floatexp, with the same
+// rebase and glitch tests, until |dz| has grown back into double range; the
+// rest of the orbit runs on plain doubles.
+//
+// Where the pixel orbit passes much closer to 0 than the reference does
+// (|Z + dz| << |Z|), dz has cancelled away its significant bits and the pixel
+// is glitched (Pauldelbrot's test). Glitched pixels are re-rendered in further
+// passes, each against a new reference placed inside the largest glitch.
+//
+// Rebasing (Zhuoran) prevents most glitches from forming: whenever |Z + dz| <
+// |dz|, or the reference runs out, the pixel continues from the start of the
+// same reference with dz = Z + dz. One reference then serves nearly every
+// pixel. FRACTAL_REBASE=0 turns it off to compare.
+//
+// With a checkpoint file the centre's orbit is loaded from it when it was
+// computed for the same point at sufficient precision, extended if more
+// iterations are asked for, and saved back.
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include "kernel.h"
+#include "deep.h"
+#include "iterdata.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FE_DOUBLE_EXP (-960)    // deltas above 2^-960 continue in doubles
+#define FE_PIXEL_EXP (FE_DOUBLE_EXP+64)     // pixel spacing at or below 2^-896 (~1e-270) needs floatexp
+#define GLITCH_TOL 1e-6         // Pauldelbrot: |Z+dz|^2 < tol |Z|^2 means dz lost its precision
+#define MAX_PASSES 64           // references tried before leaving glitches in place
+#define MU_BOUNDED (-1.0f)
+#define MU_GLITCH (-2.0f)
+
+typedef struct {
+    int width, height, maxIter;
+    const RefOrbit* ref;
+    double refX, refY;          // reference position in pixels from the top-left corner
+    floatexp pixel;             // pixel spacing
+    int useFloatexp;
+    int rebase;                 // rebase pixels onto the start of the reference
+    float* mu;                  // smooth iteration count, MU_BOUNDED or MU_GLITCH
+    const int* list;            // pixels to render this pass, NULL for every row
+    int count;                  // rows or list entries
+    volatile int next;
+    long long glitched[256];    // per worker
+    long long rebases[256];
+} DeepJob;
+
+// Escape iteration of one pixel, maxIter when bounded, -1 when glitched: the
+// delta lost its precision against the reference, or the reference escaped
+// first. Rebasing avoids both, so with it on glitches are all but gone.
+static int perturbPixel(const DeepJob* j, int px, int py, double* r2, long long* rebases){
+    const RefOrbit* o=j->ref;
+    floatexp dcr=feMulD(j->pixel,px+0.5-j->refX), dci=feMulD(j->pixel,j->refY-(py+0.5));
+    double dzr=0.0, dzi=0.0;
+    int n=0, m=0;       // m indexes the reference and only differs from n after a rebase
+
+    if(j->useFloatexp){
+        // The same iteration as below with every quantity in floatexp, rebase
+        // and glitch tests included, until |dz| has grown back into double range
+        floatexp fr=feFromDouble(0.0), fi=fr, tol=feFromDouble(GLITCH_TOL);
+        while(fr.e<=FE_DOUBLE_EXP && fi.e<=FE_DOUBLE_EXP){
+            floatexp Zr=feFromDouble(o->zr[m]), Zi=feFromDouble(o->zi[m]);
+            floatexp zr=feAdd(Zr,fr), zi=feAdd(Zi,fi), z2=feNorm2(zr,zi);
+            *r2=feToDouble(z2);
+            if(*r2>DEEP_BAILOUT) return n;
+            if(n>=j->maxIter) return j->maxIter;
+            if(j->rebase && (feLess(z2,feNorm2(fr,fi)) || m>=o->length-1)){
+                fr=zr; fi=zi; m=0;
+                (*rebases)++;
+            }
+            else if(feLess(z2,feMul(tol,feNorm2(Zr,Zi))) || m>=o->length-1) return -1;
+            floatexp ar=feAdd(feLdexp(Zr,1),fr), ai=feAdd(feLdexp(Zi,1),fi);
+            floatexp t=feAdd(feSub(feMul(ar,fr),feMul(ai,fi)),dcr);
+            fi=feAdd(feAdd(feMul(ar,fi),feMul(ai,fr)),dci);
+            fr=t;
+            n++; m++;
+        }
+        dzr=feToDouble(fr); dzi=feToDouble(fi);
+    }
+
+    // dc underflows to 0 here when below double range, by which point it is
+    // far below the precision of dz anyway
+    double cr=feToDouble(dcr), ci=feToDouble(dci);
+    for(;;){
+        double zr=o->zr[m]+dzr, zi=o->zi[m]+dzi;
+        *r2=zr*zr+zi*zi;
+        if(*r2>DEEP_BAILOUT) return n;
+        if(n>=j->maxIter) return j->maxIter;
+        if(j->rebase && (*r2<dzr*dzr+dzi*dzi || m>=o->length-1)){
+            // Zhuoran: restart the reference, carrying the whole value as the delta
+            dzr=zr; dzi=zi; m=0;
+            (*rebases)++;
+        }
+        else if(*r2<GLITCH_TOL*(o->zr[m]*o->zr[m]+o->zi[m]*o->zi[m]) || m>=o->length-1) return -1;
+        double ar=2.0*o->zr[m]+dzr, ai=2.0*o->zi[m]+dzi;
+        double t=ar*dzr-ai*dzi+cr;
+        dzi=ar*dzi+ai*dzr+ci;
+        dzr=t;
+        n++; m++;
+    }
+}
+
+static void renderPixel(DeepJob* j, int worker, int i){
+    double r2;
+    int n=perturbPixel(j,i%j->width,i/j->width,&r2,&j->rebases[worker]);
+    if(n<0){ j->glitched[worker]++; j->mu[i]=MU_GLITCH; }
+    else j->mu[i] = n>=j->maxIter ? MU_BOUNDED : (float)(n-log2(0.5*log(r2)));
+}
+
+static void deepWorker(void* ctx, int worker){
+    DeepJob* j=(DeepJob*)ctx;
+    for(;;){
+        if(!j->list){
+            int py=atomicFetchAdd(&j->next,1);
+            if(py>=j->count) return;
+            for(int px=0;px<j->width;px++) renderPixel(j,worker,py*j->width+px);
+        } else {
+            int k=atomicFetchAdd(&j->next,256);
+            if(k>=j->count) return;
+            int end = k+256<j->count ? k+256 : j->count;
+            for(;k<end;k++) renderPixel(j,worker,j->list[k]);
+        }
+    }
+}
+
+static long long runPass(DeepJob* j, int workers){
+    j->next=0;
+    for(int i=0;i<workers;i++) j->glitched[i]=0;
+    runWorkers(workers,deepWorker,j);
+    long long glitched=0;
+    for(int i=0;i<workers;i++) glitched+=j->glitched[i];
+    return glitched;
+}
+
+// Collects glitched pixels into list and returns the pixel nearest the
+// centroid of the largest 4-connected glitch, where the next reference goes
+static int pickReference(const DeepJob* j, int* list, int* count, int* label, int* queue){
+    int w=j->width, h=j->height, n=w*h;
+    *count=0;
+    for(int i=0;i<n;i++){
+        label[i] = j->mu[i]==MU_GLITCH ? 0 : -1;
+        if(!label[i]) list[(*count)++]=i;
+    }
+    int best=-1, bestSize=0, nextLabel=1;
+    for(int k=0;k<*count;k++){
+        int seed=list[k];
+        if(label[seed]) continue;
+        int head=0, tail=0;
+        double sx=0.0, sy=0.0;
+        label[seed]=nextLabel; queue[tail++]=seed;
+        while(head<tail){
+            int i=queue[head++], x=i%w, y=i/w;
+            sx+=x; sy+=y;
+            int nb[4]={ x>0?i-1:-1, x<w-1?i+1:-1, y>0?i-w:-1, y<h-1?i+w:-1 };
+            for(int d=0;d<4;d++) if(nb[d]>=0 && !label[nb[d]]){ label[nb[d]]=nextLabel; queue[tail++]=nb[d]; }
+        }
+        if(tail>bestSize){
+            // queue still holds this component
+            double cx=sx/tail, cy=sy/tail, bestD=1e300;
+            for(int q=0;q<tail;q++){
+                double dx=queue[q]%w-cx, dy=queue[q]/w-cy, d=dx*dx+dy*dy;
+                if(d<bestD){ bestD=d; best=queue[q]; }
+            }
+            bestSize=tail;
+        }
+        nextLabel++;
+    }
+    return best;
+}
+
+// Palette over the image's own range of escape times
+static void colorize(const float* mu, size_t n, unsigned char* rgb){
+    float lo=1e30f, hi=-1e30f;
+    for(size_t i=0;i<n;i++) if(mu[i]>=0.0f){ if(mu[i]<lo) lo=mu[i]; if(mu[i]>hi) hi=mu[i]; }
+    float inv = hi>lo ? 1.0f/(hi-lo) : 1.0f;
+    for(size_t i=0;i<n;i++){
+        if(mu[i]<0.0f){ rgb[i*3]=rgb[i*3+1]=rgb[i*3+2]=0; continue; }
+        paletteRGB((mu[i]-lo)*inv,rgb+i*3);
+    }
+}
+
+// Renders the view centred on (cx, cy) against ref, wherever ref lies, then
+// fixes what glitched with extra references. Returns the glitched pixels left.
+static long long renderView(DeepJob* j, const RefOrbit* ref, mpfr_srcptr cx, mpfr_srcptr cy, floatexp radius, int verbose){
+    int w=j->width, h=j->height;
+    double t0=nowSeconds();
+    j->ref=ref;
+    j->pixel=feLdexp(feMulD(radius,1.0/h),1);
+    j->useFloatexp=j->pixel.e<=FE_PIXEL_EXP;
+    const char* rebase=getenv("FRACTAL_REBASE");
+    j->rebase=!rebase || strcmp(rebase,"0")!=0;
+
+    // reference position in pixels
+    mpfr_t d;
+    mpfr_init2(d,ref->prec);
+    mpfr_sub(d,ref->cr,cx,MPFR_RNDN);
+    j->refX=w*0.5+feToDouble(feDiv(feFromMpfr(d),j->pixel));
+    mpfr_sub(d,ref->ci,cy,MPFR_RNDN);
+    j->refY=h*0.5-feToDouble(feDiv(feFromMpfr(d),j->pixel));
+    mpfr_clear(d);
+
+    int workers=cpuCount(); if(workers>256) workers=256;
+    for(int i=0;i<workers;i++) j->rebases[i]=0;
+    j->list=NULL; j->count=h;
+    long long glitched=runPass(j,workers);
+    if(verbose) printf("pass 0: %.3fs on %d threads (%s deltas), %lld glitched\n",
+                       nowSeconds()-t0,workers,j->useFloatexp?"floatexp":"double",glitched);
+
+    // Each further pass puts a reference inside the largest glitch and
+    // re-renders every glitched pixel against it. The reference pixel itself
+    // has dc = 0 and can't glitch, so each pass makes progress.
+    int pass=1;
+    if(glitched){
+        size_t n=(size_t)w*h;
+        int* list=(int*)malloc(n*sizeof(int));
+        int* label=(int*)malloc(n*sizeof(int));
+        int* queue=(int*)malloc(n*sizeof(int));
+        RefOrbit fix;
+        refOrbitInit(&fix,ref->prec);
+        mpfr_t step;
+        mpfr_init2(step,ref->prec);
+        mpfr_set_d(step,j->pixel.m,MPFR_RNDN);
+        mpfr_mul_2si(step,step,j->pixel.e,MPFR_RNDN);
+        for(; glitched && pass<=MAX_PASSES; pass++){
+            int count, q=pickReference(j,list,&count,label,queue);
+            double t1=nowSeconds();
+            j->refX=q%w+0.5; j->refY=q/w+0.5;
+            mpfr_mul_d(fix.cr,step,j->refX-w*0.5,MPFR_RNDN);
+            mpfr_add(fix.cr,fix.cr,cx,MPFR_RNDN);
+            mpfr_mul_d(fix.ci,step,h*0.5-j->refY,MPFR_RNDN);
+            mpfr_add(fix.ci,fix.ci,cy,MPFR_RNDN);
+            if(refOrbitCompute(&fix,j->maxIter)<0) break;     // leave the glitches
+            double t2=nowSeconds();
+
+            j->ref=&fix; j->list=list; j->count=count;
+            glitched=runPass(j,workers);
+            if(verbose) printf("pass %d: reference at (%d,%d), %d iterations in %.3fs; %d pixels re-rendered in %.3fs, %lld still glitched\n",
+                               pass,q%w,q/w,fix.length-1,t2-t1,count,nowSeconds()-t2,glitched);
+        }
+        mpfr_clear(step);
+        refOrbitFree(&fix);
+        free(list); free(label); free(queue);
+        j->ref=ref;
+    }
+
+    long long rebases=0;
+    for(int i=0;i<workers;i++) rebases+=j->rebases[i];
+    if(verbose) printf("%d reference%s, %lld rebases, %.3fs, %lld glitched pixels left\n",
+                       pass,pass>1?"s":"",rebases,nowSeconds()-t0,glitched);
+    return glitched;
+}
+
+int deepMain(int argc, char** argv){
+    if(argc<4){
+        printf("usage: fractal.exe deep <out.png|out.fit> <re> <im> <radius> [WxH] [iterations] [orbit checkpoint]\n");
+        return 1;
+    }
+    DeepJob* j=(DeepJob*)calloc(1,sizeof(DeepJob));
+    j->width=1280; j->height=720; j->maxIter=5000;
+    if(argc>4) sscanf(argv[4],"%dx%d",&j->width,&j->height);
+    if(argc>5) j->maxIter=atoi(argv[5]);
+
+    mpfr_t radius;
+    mpfr_init2(radius,64);
+    if(mpfr_set_str(radius,argv[3],10,MPFR_RNDN)!=0 || mpfr_sgn(radius)<=0 || j->width<1 || j->height<1 || j->maxIter<1){
+        fprintf(stderr,"deep: bad arguments\n");
+        mpfr_clear(radius); free(j);
+        return 1;
+    }
+    floatexp r=feFromMpfr(radius);
+    mpfr_clear(radius);
+
+    mpfr_prec_t prec=deepPrecision(r,j->height);
+    const char* checkpoint = argc>6 ? argv[6] : NULL;
+    RefOrbit ref;
+    int reused=0;
+    if(checkpoint && refOrbitLoad(&ref,checkpoint)){
+        // usable when computed at least as precisely for the same centre
+        mpfr_t re, im;
+        mpfr_init2(re,ref.prec); mpfr_init2(im,ref.prec);
+        reused=ref.prec>=prec && mpfr_set_str(re,argv[1],10,MPFR_RNDN)==0 && mpfr_set_str(im,argv[2],10,MPFR_RNDN)==0
+            && mpfr_cmp(re,ref.cr)==0 && mpfr_cmp(im,ref.ci)==0;
+        mpfr_clear(re); mpfr_clear(im);
+        if(reused) prec=ref.prec;
+        else refOrbitFree(&ref);
+    }
+    if(!reused){
+        refOrbitInit(&ref,prec);
+        if(mpfr_set_str(ref.cr,argv[1],10,MPFR_RNDN)!=0 || mpfr_set_str(ref.ci,argv[2],10,MPFR_RNDN)!=0){
+            fprintf(stderr,"deep: bad centre\n");
+            refOrbitFree(&ref); free(j);
+            return 1;
+        }
+    }
+
+    double t0=nowSeconds();
+    int prefix = reused ? ref.length-1 : 0;
+    int length = reused ? refOrbitExtend(&ref,j->maxIter) : refOrbitCompute(&ref,j->maxIter);
+    if(length<0){
+        refOrbitFree(&ref); free(j);
+        return 1;
+    }
+    printf("reference: %d iterations%s at %ld bits in %.3fs",ref.length-1,ref.escaped?" (escaped)":"",(long)prec,nowSeconds()-t0);
+    if(reused) printf(", %d from %s",prefix,checkpoint);
+    printf("\n");
+    if(checkpoint && ref.length-1>prefix && !refOrbitSave(&ref,checkpoint))
+        fprintf(stderr,"deep: cannot write %s\n",checkpoint);
+
+    size_t n=(size_t)j->width*j->height;
+    j->mu=(float*)malloc(n*sizeof(float));
+    renderView(j,&ref,ref.cr,ref.ci,r,1);
+
+    int ok;
+    size_t len=strlen(argv[0]);
+    if(len>4 && strcmp(argv[0]+len-4,".fit")==0) ok=iterWrite(argv[0],j->mu,j->width,j->height,ITER_FRAC_BITS);
+    else {
+        unsigned char* rgb=(unsigned char*)malloc(n*3);
+        colorize(j->mu,n,rgb);
+        ok=writePNG(argv[0],rgb,j->width,j->height);
+        free(rgb);
+    }
+    if(!ok) fprintf(stderr,"deep: cannot write %s\n",argv[0]);
+    free(j->mu); free(j);
+    refOrbitFree(&ref);
+    return ok ? 0 : 1;
+}
+
+// --- Interactive view ---
+//
+//   fractal.exe deepview <re> <im> <radius> [iterations]
+//
+// Drag and wheel as in the shader viewer, +/- double or halve the iterations.
+// The window's input moves cx, cy and scale, which here start at 0, 0, 1 and
+// are folded into the MPFR centre and floatexp radius once per frame, then
+// reset. Resizing keeps the radius (the half-height) and re-renders. Every
+// frame's reference comes from an orbit cache, so a zoom step renders against
+// the orbit already on screen and only extends it when iterations are raised.
+static const char* deepViewFragmentSource = R"(
+#version 330 core
+in vec2 uv;
+out vec4 FragColor;
+uniform sampler2D u_image;  // rows top first, in the top-left of a pooled texture
+uniform int u_rows;
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    FragColor = texelFetch(u_image, ivec2(p.x, u_rows - 1 - p.y), 0);
+}
+)";
+
+static void printRadius(floatexp r){
+    double l=log10(fabs(r.m))+r.e*0.30102999566398120;
+    double e=floor(l);
+    printf("%.3fe%+.0f",pow(10.0,l-e),e);
+}
+
+int deepViewMain(int argc, char** argv){
+    if(argc<3){
+        printf("usage: fractal.exe deepview <re> <im> <radius> [iterations]\n");
+        return 1;
+    }
+    mpfr_t radius;
+    mpfr_init2(radius,64);
+    int ok=mpfr_set_str(radius,argv[2],10,MPFR_RNDN)==0 && mpfr_sgn(radius)>0;
+    floatexp r=feFromMpfr(radius);
+    mpfr_clear(radius);
+    maxIter = argc>3 ? atoi(argv[3]) : 5000;
+    if(!ok || maxIter<1){
+        fprintf(stderr,"deepview: bad arguments\n");
+        return 1;
+    }
+
+    GLWindow win;
+    createGLWindow(&win,"Deep zoom",1);
+    int w, h;
+    glWindowSize(&win,&w,&h);
+    if(w<1) w=1;
+    if(h<1) h=1;
+
+    mpfr_t re, im;
+    mpfr_init2(re,deepPrecision(r,h)); mpfr_init2(im,deepPrecision(r,h));
+    if(mpfr_set_str(re,argv[0],10,MPFR_RNDN)!=0 || mpfr_set_str(im,argv[1],10,MPFR_RNDN)!=0)
+        fatalError("Error","Bad centre");
+
+    GLuint program=createProgram(vertexShaderSource,deepViewFragmentSource);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program,"u_image"),0);
+    GLint locRows=glGetUniformLocation(program,"u_rows");
+    glUniform1i(locRows,h);
+    GLuint VAO=createQuad();
+    GLuint tex;
+    int texW=0, texH=0;
+    glGenTextures(1,&tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT,1);
+    growTexture(tex,GL_RGB8,GL_RGB,GL_UNSIGNED_BYTE,w,h,&texW,&texH);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+
+    OrbitCache cache;
+    orbitCacheInit(&cache);
+    DeepJob* j=(DeepJob*)calloc(1,sizeof(DeepJob));
+    j->width=w; j->height=h;
+    size_t n=(size_t)w*h, capacity=n;
+    j->mu=(float*)malloc(n*sizeof(float));
+    unsigned char* rgb=(unsigned char*)malloc(n*3);
+
+    cx=0.0; cy=0.0; scale=1.0;
+    int dirty=1, shownIter=maxIter;
+    while(pollGLWindow(&win)){
+        int newW, newH;
+        glWindowSize(&win,&newW,&newH);
+        if(newW<1 || newH<1){ sleepMs(10); continue; }   // minimized
+        if(newW!=w || newH!=h){
+            // CPU buffers and the texture only ever grow
+            w=newW; h=newH; n=(size_t)w*h;
+            if(n>capacity){
+                capacity=n;
+                free(j->mu); free(rgb);
+                j->mu=(float*)malloc(n*sizeof(float));
+                rgb=(unsigned char*)malloc(n*3);
+            }
+            j->width=w; j->height=h;
+            growTexture(tex,GL_RGB8,GL_RGB,GL_UNSIGNED_BYTE,w,h,&texW,&texH);
+            glUniform1i(locRows,h);
+            glViewport(0,0,w,h);
+            dirty=1;
+        }
+
+        if(cx!=0.0 || cy!=0.0 || scale!=1.0 || maxIter!=shownIter){
+            // cx, cy are in half-heights of the old view
+            mpfr_prec_t prec=deepPrecision(feMulD(r,scale),h);
+            if(mpfr_get_prec(re)<prec){ mpfr_prec_round(re,prec,MPFR_RNDN); mpfr_prec_round(im,prec,MPFR_RNDN); }
+            floatexp dx=feMulD(r,cx), dy=feMulD(r,cy);
+            mpfr_t d;
+            mpfr_init2(d,53);
+            mpfr_set_d(d,dx.m,MPFR_RNDN); mpfr_mul_2si(d,d,dx.e,MPFR_RNDN); mpfr_add(re,re,d,MPFR_RNDN);
+            mpfr_set_d(d,dy.m,MPFR_RNDN); mpfr_mul_2si(d,d,dy.e,MPFR_RNDN); mpfr_add(im,im,d,MPFR_RNDN);
+            mpfr_clear(d);
+            r=feMulD(r,scale);
+            cx=0.0; cy=0.0; scale=1.0;
+            shownIter=maxIter;
+            dirty=1;
+        }
+
+        if(dirty){
+            mpfr_prec_t prec=deepPrecision(r,h);
+            if(mpfr_get_prec(re)<prec){ mpfr_prec_round(re,prec,MPFR_RNDN); mpfr_prec_round(im,prec,MPFR_RNDN); }
+            int hits=cache.hits, extends=cache.extends;
+            double t0=nowSeconds();
+            RefOrbit* ref=orbitCacheLookup(&cache,re,im,feMulD(r,(double)w/h),r,prec,maxIter);
+            double t1=nowSeconds();
+            if(!ref){ dirty=0; continue; }
+            j->maxIter=maxIter;
+            long long glitched=renderView(j,ref,re,im,r,0);
+            colorize(j->mu,n,rgb);
+            glTexSubImage2D(GL_TEXTURE_2D,0,0,0,w,h,GL_RGB,GL_UNSIGNED_BYTE,rgb);
+
+            printf("radius "); printRadius(r);
+            printf(": %s reference, %d iterations at %ld bits in %.3fs; render %.3fs, %lld glitched\n",
+                   cache.hits>hits?"cached":cache.extends>extends?"extended":"new",
+                   ref->length-1,(long)ref->prec,t1-t0,nowSeconds()-t1,glitched);
+            dirty=0;
+        } else sleepMs(10);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+        swapGLWindow(&win);
+    }
+
+    printf("orbit cache: %d hits, %d extended, %d computed\n",cache.hits,cache.extends,cache.misses);
+    orbitCacheFree(&cache);
+    free(rgb); free(j->mu); free(j);
+    mpfr_clear(re); mpfr_clear(im);
+    glDeleteTextures(1,&tex);
+    destroyGLWindow(&win);
+    return 0;
+}
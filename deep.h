@@ -0,0 +1,79 @@
+// Deep zoom: perturbation rendering against high-precision reference orbits
+#ifndef DEEP_H
+#define DEEP_H
+
+#include <mpfr.h>
+#include "floatexp.h"
+
+#define DEEP_BAILOUT 1e4    // squared escape radius for reference and pixels
+
+// Z_0..Z_{length-1} of the orbit of c = (cr, ci), rounded to doubles
+typedef struct {
+    mpfr_t cr, ci;
+    mpfr_t x, y;        // Z_{length-1} at full precision, to resume from
+    mpfr_prec_t prec;
+    double* zr;
+    double* zi;
+    int length;         // stored points
+    int capacity;
+    int escaped;        // Z_{length-1} is past the bailout
+} RefOrbit;
+
+void refOrbitInit(RefOrbit* o, mpfr_prec_t prec);
+void refOrbitFree(RefOrbit* o);
+// Iterates from Z_0 = 0 up to maxIter steps or escape; returns length, or -1
+// when memory runs out (the points so far stay valid)
+int refOrbitCompute(RefOrbit* o, int maxIter);
+// Continues from the last stored point up to maxIter steps or escape
+int refOrbitExtend(RefOrbit* o, int maxIter);
+// Checkpoints; load initializes o and returns 0 if the file is missing or bad
+int refOrbitSave(const RefOrbit* o, const char* path);
+int refOrbitLoad(RefOrbit* o, const char* path);
+
+// --- Orbit cache ---
+// Recently used reference orbits, so zooming and panning inside a view reuses
+// (and extends) its orbit instead of recomputing it at every step
+#define ORBIT_CACHE_SIZE 8
+
+typedef struct {
+    RefOrbit orbit[ORBIT_CACHE_SIZE];
+    unsigned stamp[ORBIT_CACHE_SIZE];   // last use, 0 = empty
+    unsigned clock;
+    int hits, extends, misses;
+} OrbitCache;
+
+void orbitCacheInit(OrbitCache* c);
+void orbitCacheFree(OrbitCache* c);
+// An orbit valid for the view centred on (cx, cy) with the given half-width
+// and half-height: at least prec bits, c inside the view, and maxIter
+// iterations long (extended if needed). Computes one at the centre on a miss.
+// NULL when memory runs out; an orbit cut short stays cached, still valid.
+RefOrbit* orbitCacheLookup(OrbitCache* c, mpfr_srcptr cx, mpfr_srcptr cy, floatexp halfW, floatexp halfH,
+                           mpfr_prec_t prec, int maxIter);
+
+// --- Nuclei (nucleus.c) ---
+// Lowest period with a nucleus in the square of half-side radius around c;
+// when there is none up to maxPeriod, the period of c's atom domain with
+// *inView = 0
+int nucleusPeriod(mpfr_srcptr cr, mpfr_srcptr ci, floatexp radius, int maxPeriod, int* inView);
+// Refines c towards the nucleus of the given period at c's precision; returns
+// the steps taken, negative if it did not converge
+int nucleusNewton(mpfr_ptr cr, mpfr_ptr ci, int period, int maxSteps);
+// Size estimate of the minibrot at a nucleus, and its orientation in radians
+floatexp nucleusSize(mpfr_srcptr cr, mpfr_srcptr ci, int period, double* angle);
+
+// Bits to resolve one pixel of a view of the given half-height plus guard bits,
+// rounded up so successive zooms into one point share a precision
+static inline mpfr_prec_t deepPrecision(floatexp radius, int height){
+    mpfr_prec_t prec=64+(radius.e<0 ? -radius.e : 0);
+    while(height>1){ prec++; height>>=1; }
+    return (prec+255)/256*256;
+}
+
+static inline floatexp feFromMpfr(mpfr_srcptr x){
+    long e;
+    double m=mpfr_get_d_2exp(&e,x,MPFR_RNDN);
+    return feNorm(m,(int)e);
+}
+
+#endif
@@ -0,0 +1,192 @@
+// Escape-time iteration with distance estimation, and the "de" still renderer
+//
+//   fractal.exe de <mandelbrot|multibrot3|julia> <out.png> [WxH] [iterations] [cx cy scale]
+//
+// The exterior distance estimate 0.5*|z|*log|z|/|dz| is a lower bound on the
+// distance to the set (Koebe 1/4), and the true distance is 1-Lipschitz. So
+// when the estimate at a block's centre exceeds the block's half-diagonal plus
+// the shading width, every pixel inside is plain exterior and the block is
+// filled without iterating it. Blocks that fail the test are split in four.
+//
+// The fill is not identical to per-pixel rendering: a pixel's own estimate can
+// be up to 4x below its true distance, so near the outer edge of the shading
+// band the fill leaves white a few pixels that per-pixel shading would grey.
+// The bound needs a connected set; a Julia c outside the Mandelbrot set (such
+// as the default) gives dust, so those renders are iterated per pixel.
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include "escape.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DE_BLOCK 64         // work unit handed to a worker
+#define DE_MIN_FILL 4       // smaller blocks are iterated per pixel
+#define DE_WIDTH 2.0        // boundary shading width in pixels, as in the shaders
+
+static const char* formulaNames[FORMULA_COUNT]={"mandelbrot","multibrot3","julia"};
+
+int formulaFromName(const char* name){
+    for(int f=0;f<FORMULA_COUNT;f++){
+        size_t n=strlen(formulaNames[f]);
+        if(strncmp(name,formulaNames[f],n)==0 && (name[n]=='\0' || strcmp(name+n,".frag")==0)) return f;
+    }
+    return -1;
+}
+
+void defaultEscapeParams(EscapeParams* p, Formula f, int maxIter){
+    p->formula=f;
+    p->jr=-0.8; p->ji=0.156;    // julia.frag's constant
+    p->maxIter=maxIter;
+    p->bailout=1e12;
+}
+
+int escapePoint(const EscapeParams* p, double x, double y, double* mu, double* de){
+    double zr, zi, cr, ci, dr, di;
+    if(p->formula==FORMULA_JULIA){ zr=x; zi=y; cr=p->jr; ci=p->ji; dr=1.0; di=0.0; }
+    else { zr=0.0; zi=0.0; cr=x; ci=y; dr=0.0; di=0.0; }
+
+    int i;
+    double r2=0.0;
+    for(i=0;i<p->maxIter;i++){
+        double t;
+        switch(p->formula){
+        case FORMULA_MULTIBROT3: {
+            // dz = 3z^2 dz + 1, z = z^3 + c
+            double z2r=zr*zr-zi*zi, z2i=2.0*zr*zi;
+            t=3.0*(z2r*dr-z2i*di)+1.0; di=3.0*(z2r*di+z2i*dr); dr=t;
+            t=z2r*zr-z2i*zi+cr; zi=z2r*zi+z2i*zr+ci; zr=t;
+            break;
+        }
+        case FORMULA_JULIA:
+            // dz = 2z dz
+            t=2.0*(zr*dr-zi*di); di=2.0*(zr*di+zi*dr); dr=t;
+            t=zr*zr-zi*zi+cr; zi=2.0*zr*zi+ci; zr=t;
+            break;
+        default:
+            // dz = 2z dz + 1
+            t=2.0*(zr*dr-zi*di)+1.0; di=2.0*(zr*di+zi*dr); dr=t;
+            t=zr*zr-zi*zi+cr; zi=2.0*zr*zi+ci; zr=t;
+            break;
+        }
+        r2=zr*zr+zi*zi;
+        if(r2>p->bailout) break;
+    }
+
+    if(i==p->maxIter){
+        if(mu) *mu=p->maxIter;
+        if(de) *de=0.0;
+        return i;
+    }
+    double r=sqrt(r2), lr=log(r);
+    if(mu) *mu=i+1.0-log(lr)/log(p->formula==FORMULA_MULTIBROT3 ? 3.0 : 2.0);
+    if(de) *de=0.5*r*lr/sqrt(dr*dr+di*di);
+    return i;
+}
+
+// --- DE still renderer ---
+typedef struct {
+    EscapeParams params;
+    View view;
+    double x0, y0, pixel;       // top-left pixel corner and pixel size
+    unsigned char* gray;
+    int blocksX, blockCount;
+    int blockFill;              // 0: the set may be disconnected, no fill
+    volatile int nextBlock;
+    long long filled[256];      // per worker
+} DEJob;
+
+static unsigned char deShade(const DEJob* j, int iter, double de){
+    if(iter==j->params.maxIter) return 0;
+    double t=sqrt(de/(DE_WIDTH*j->pixel));
+    return t>=1.0 ? 255 : (unsigned char)(t*255.0);
+}
+
+static void deBlock(DEJob* j, int worker, int x, int y, int size){
+    int w=j->view.width, h=j->view.height;
+    int xe = x+size<w ? x+size : w, ye = y+size<h ? y+size : h;
+    if(x>=xe || y>=ye) return;
+
+    if(size>DE_MIN_FILL && j->blockFill){
+        double de;
+        double bx=j->x0+(x+size*0.5)*j->pixel, by=j->y0-(y+size*0.5)*j->pixel;
+        int it=escapePoint(&j->params,bx,by,NULL,&de);
+        if(it<j->params.maxIter && de-size*0.7072*j->pixel>=DE_WIDTH*j->pixel){
+            for(int py=y;py<ye;py++) memset(j->gray+(size_t)py*w+x,255,xe-x);
+            j->filled[worker]+=(long long)(xe-x)*(ye-y);
+            return;
+        }
+        int half=size/2;
+        deBlock(j,worker,x,y,half);        deBlock(j,worker,x+half,y,half);
+        deBlock(j,worker,x,y+half,half);   deBlock(j,worker,x+half,y+half,half);
+        return;
+    }
+
+    for(int py=y;py<ye;py++){
+        for(int px=x;px<xe;px++){
+            double de;
+            int it=escapePoint(&j->params,j->x0+(px+0.5)*j->pixel,j->y0-(py+0.5)*j->pixel,NULL,&de);
+            j->gray[(size_t)py*w+px]=deShade(j,it,de);
+        }
+    }
+}
+
+static void deWorker(void* ctx, int worker){
+    DEJob* j=(DEJob*)ctx;
+    for(;;){
+        int b=atomicFetchAdd(&j->nextBlock,1);
+        if(b>=j->blockCount) return;
+        deBlock(j,worker,(b%j->blocksX)*DE_BLOCK,(b/j->blocksX)*DE_BLOCK,DE_BLOCK);
+    }
+}
+
+int distanceMain(int argc, char** argv){
+    if(argc<2 || formulaFromName(argv[0])<0){
+        printf("usage: fractal.exe de <mandelbrot|multibrot3|julia> <out.png> [WxH] [iterations] [cx cy scale]\n");
+        return 1;
+    }
+    DEJob* j=(DEJob*)calloc(1,sizeof(DEJob));
+    Formula f=(Formula)formulaFromName(argv[0]);
+    View* v=&j->view;
+    v->width=1920; v->height=1080;
+    v->cx = f==FORMULA_MANDELBROT ? -0.5 : 0.0; v->cy=0.0; v->scale=1.5;
+    int iter=1000;
+    if(argc>2) sscanf(argv[2],"%dx%d",&v->width,&v->height);
+    if(argc>3) iter=atoi(argv[3]);
+    if(argc>6){ v->cx=atof(argv[4]); v->cy=atof(argv[5]); v->scale=atof(argv[6]); }
+    if(v->width<1 || v->height<1 || iter<1){ fprintf(stderr,"de: bad arguments\n"); free(j); return 1; }
+
+    defaultEscapeParams(&j->params,f,iter);
+    j->blockFill=1;
+    if(f==FORMULA_JULIA){
+        // connected iff the critical orbit of c stays bounded
+        EscapeParams m;
+        defaultEscapeParams(&m,FORMULA_MANDELBROT,iter);
+        j->blockFill=escapePoint(&m,j->params.jr,j->params.ji,NULL,NULL)==iter;
+    }
+    j->pixel=2.0*v->scale/v->height;
+    j->x0=v->cx-j->pixel*v->width*0.5;
+    j->y0=v->cy+v->scale;
+    j->blocksX=(v->width+DE_BLOCK-1)/DE_BLOCK;
+    j->blockCount=j->blocksX*((v->height+DE_BLOCK-1)/DE_BLOCK);
+    j->gray=(unsigned char*)malloc((size_t)v->width*v->height);
+
+    int workers=cpuCount(); if(workers>256) workers=256;
+    double t0=nowSeconds();
+    runWorkers(workers,deWorker,j);
+    double dt=nowSeconds()-t0;
+
+    long long filled=0;
+    for(int i=0;i<workers;i++) filled+=j->filled[i];
+    size_t n=(size_t)v->width*v->height;
+    printf("%.3fs, %.1f%% of pixels filled from distance estimates\n",dt,100.0*filled/n);
+
+    unsigned char* rgb=(unsigned char*)malloc(n*3);
+    for(size_t i=0;i<n;i++) rgb[i*3]=rgb[i*3+1]=rgb[i*3+2]=j->gray[i];
+    int ok=writePNG(argv[1],rgb,v->width,v->height);
+    if(!ok) fprintf(stderr,"de: cannot write %s\n",argv[1]);
+    free(rgb); free(j->gray); free(j);
+    return ok ? 0 : 1;
+}
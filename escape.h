@@ -0,0 +1,29 @@
+// CPU escape-time iteration shared by the headless renderers
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+typedef enum { FORMULA_MANDELBROT, FORMULA_MULTIBROT3, FORMULA_JULIA, FORMULA_COUNT } Formula;
+
+typedef struct {
+    Formula formula;
+    double jr, ji;      // Julia parameter
+    int maxIter;
+    double bailout;     // squared escape radius
+} EscapeParams;
+
+// View in the shaders' convention: scale is the half-height of the image
+typedef struct {
+    int width, height;
+    double cx, cy, scale;
+} View;
+
+// Accepts "mandelbrot", "multibrot3.frag", ...; -1 when unknown
+int formulaFromName(const char* name);
+void defaultEscapeParams(EscapeParams* p, Formula f, int maxIter);
+
+// Iterates one point. Returns the escape iteration (maxIter when bounded); mu gets
+// the smooth iteration count and de a lower bound on the distance to the set
+// (0 when bounded). Either may be NULL.
+int escapePoint(const EscapeParams* p, double x, double y, double* mu, double* de);
+
+#endif
@@ -0,0 +1,199 @@
+// Julia parameter explorer: a contact sheet of Julia sets over a lattice of c
+//
+//   fractal.exe explore <julia.frag|kernel> <out.png> [N] [thumb] [iterations] [re im span]
+//
+// Thumbnail (col,row) of the N x N sheet shows the Julia set for
+//
+//   c = (re - span + (col+0.5)*2*span/N,  im + span - (row+0.5)*2*span/N)
+//
+// over [-1.5,1.5]^2, so the sheet reads like the Mandelbrot set it samples;
+// pick one and pass it on as FRACTAL_C=<re>,<im>. The defaults cover the whole
+// set (re -0.5, im 0, span 1.5).
+//
+// Shaders render the sheet in one instanced draw: explorer.c compiles them with
+// INSTANCE_PARAM defined, which makes juliaParam() read a flat per-instance c
+// from the vertex shader below instead of u_param, while the shared view
+// (centre, scale, iterations) stays in the Params block. Built-in Julia kernels
+// (specialized.c) render it as one batch of rows across all cores.
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include "kernel.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define THUMB_BORDER 1      // dark pixels around each thumbnail
+#define THUMB_SCALE 1.5     // half-height of each thumbnail's view
+
+static const char* explorerVertexSource = R"(
+#version 330 core
+layout(location=0) in vec2 aPos;
+uniform int u_columns;
+uniform vec2 u_cStart, u_cStep;     // c of thumbnail (0,0), lattice spacing
+uniform vec2 u_cell, u_border;      // in clip space
+out vec2 uv;
+flat out vec3 v_param;
+void main() {
+    int col = gl_InstanceID % u_columns, row = gl_InstanceID / u_columns;
+    v_param = vec3(u_cStart + vec2(col, row)*u_cStep, 1.0);
+    uv = aPos*0.5 + 0.5;
+    vec2 corner = vec2(-1.0 + float(col)*u_cell.x, 1.0 - float(row + 1)*u_cell.y);
+    gl_Position = vec4(corner + u_border + uv*(u_cell - 2.0*u_border), 0.0, 1.0);
+}
+)";
+
+typedef struct {
+    const BuiltinKernel* kernel;
+    KernelParams params;
+    int columns, thumb, width, height;
+    double cStart[2], cStep[2];
+    unsigned char* rgb;
+    volatile int nextRow;
+} ExplorerJob;
+
+// One sheet row per claim; each row crosses every thumbnail of its band
+static void explorerWorker(void* ctx, int worker){
+    ExplorerJob* j=(ExplorerJob*)ctx;
+    int inner=j->thumb-2*THUMB_BORDER;
+    double pixel=2.0*THUMB_SCALE/inner, logPower=log(j->kernel->power);
+    double x[SIMD_WD], y[SIMD_WD], r2[SIMD_WD];
+    int iter[SIMD_WD];
+    for(;;){
+        int row=atomicFetchAdd(&j->nextRow,1);
+        if(row>=j->height) return;
+        unsigned char* out=j->rgb+(size_t)row*j->width*3;
+        memset(out,0,(size_t)j->width*3);
+        int ty=row/j->thumb, py=row%j->thumb-THUMB_BORDER;
+        if(py<0 || py>=inner) continue;
+        KernelParams p=j->params;
+        p.ji=j->cStart[1]+ty*j->cStep[1];
+        for(int tx=0;tx<j->columns;tx++){
+            p.jr=j->cStart[0]+tx*j->cStep[0];
+            unsigned char* o=out+((size_t)tx*j->thumb+THUMB_BORDER)*3;
+            for(int px=0;px<inner;px+=SIMD_WD){
+                for(int k=0;k<SIMD_WD;k++){
+                    x[k]=-THUMB_SCALE+(px+k+0.5)*pixel;
+                    y[k]= THUMB_SCALE-(py+0.5)*pixel;
+                }
+                j->kernel->fn(&p,x,y,iter,r2);
+                for(int k=0;k<SIMD_WD && px+k<inner;k++){
+                    if(iter[k]>=p.maxIter) continue;
+                    double mu=iter[k]+1.0-log(0.5*log(r2[k]))/logPower;
+                    paletteRGB(mu/p.maxIter,o+(px+k)*3);
+                }
+            }
+        }
+    }
+}
+
+int explorerMain(int argc, char** argv){
+    if(argc<2){
+        printf("usage: fractal.exe explore <julia.frag|kernel> <out.png> [N] [thumb] [iterations] [re im span]\n");
+        return 1;
+    }
+    const char* name=argv[0];
+    const char* out=argv[1];
+    int n = argc>2 ? atoi(argv[2]) : 12;
+    int thumb = argc>3 ? atoi(argv[3]) : 128;
+    int iterations = argc>4 ? atoi(argv[4]) : 256;
+    double re=-0.5, im=0.0, span=1.5;
+    if(argc>7){ re=atof(argv[5]); im=atof(argv[6]); span=atof(argv[7]); }
+    size_t nameLen=strlen(name);
+    int shader=nameLen>5 && strcmp(name+nameLen-5,".frag")==0;
+    const BuiltinKernel* kernel = shader ? NULL : findBuiltinKernel(name);
+    if(n<1 || thumb<=2*THUMB_BORDER || iterations<1 || span<=0.0 || (!shader && (!kernel || !kernel->julia))){
+        fprintf(stderr,"explore: bad arguments (a Julia .frag or built-in Julia kernel)\n");
+        return 1;
+    }
+
+    int width=n*thumb, height=n*thumb;
+    double step=2.0*span/n;
+    double cStart[2]={re-span+0.5*step, im+span-0.5*step};
+    unsigned char* rgb=(unsigned char*)malloc((size_t)width*height*3);
+    double seconds;
+
+    if(shader){
+        char* src=loadFile(name);
+        if(!strstr(src,"INSTANCE_PARAM")){
+            fprintf(stderr,"explore: %s has no INSTANCE_PARAM variant of juliaParam()\n",name);
+            free(src); free(rgb);
+            return 1;
+        }
+        char* instanced=shaderWithDefine(src,"INSTANCE_PARAM");
+        free(src);
+
+        GLWindow win;
+        createGLWindow(&win,"Julia explorer",0);
+        GLuint program=createProgram(explorerVertexSource,instanced);
+        free(instanced);
+        if(!paramsAttach(program)) fatalError("Shader","The shader declares no Params block (see fractal.h)");
+        ParamsBuffer pb;
+        paramsInit(&pb);
+        ShaderParams sp;
+        memset(&sp,0,sizeof(sp));
+        sp.scale=(float)THUMB_SCALE;
+        sp.maxIter=iterations;
+        paramsUpdate(&pb,&sp);
+
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program,"u_columns"),n);
+        glUniform2f(glGetUniformLocation(program,"u_cStart"),(float)cStart[0],(float)cStart[1]);
+        glUniform2f(glGetUniformLocation(program,"u_cStep"),(float)step,(float)-step);
+        glUniform2f(glGetUniformLocation(program,"u_cell"),2.0f/n,2.0f/n);
+        glUniform2f(glGetUniformLocation(program,"u_border"),2.0f*THUMB_BORDER/width,2.0f*THUMB_BORDER/height);
+
+        GLuint fbo, color, vao=createQuad();
+        glGenTextures(1,&color);
+        glBindTexture(GL_TEXTURE_2D,color);
+        glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA8,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,NULL);
+        glGenFramebuffers(1,&fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER,fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,color,0);
+        if(glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE)
+            fatalError("Julia explorer","The sheet is larger than the GL framebuffer limit; use a smaller N or thumb");
+        glViewport(0,0,width,height);
+        glClearColor(0.0f,0.0f,0.0f,1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        double t0=nowSeconds();
+        glBindVertexArray(vao);
+        glDrawElementsInstanced(GL_TRIANGLES,6,GL_UNSIGNED_INT,0,n*n);
+        glFinish();
+        seconds=nowSeconds()-t0;
+
+        // GL rows are bottom-up
+        glPixelStorei(GL_PACK_ALIGNMENT,1);
+        glReadPixels(0,0,width,height,GL_RGB,GL_UNSIGNED_BYTE,rgb);
+        unsigned char* row=(unsigned char*)malloc((size_t)width*3);
+        for(int y=0;y<height/2;y++){
+            unsigned char* a=rgb+(size_t)y*width*3;
+            unsigned char* b=rgb+(size_t)(height-1-y)*width*3;
+            memcpy(row,a,(size_t)width*3); memcpy(a,b,(size_t)width*3); memcpy(b,row,(size_t)width*3);
+        }
+        free(row);
+
+        glDeleteFramebuffers(1,&fbo); glDeleteTextures(1,&color); glDeleteProgram(program);
+        paramsFree(&pb);
+        destroyGLWindow(&win);
+    } else {
+        ExplorerJob j={0};
+        j.kernel=kernel;
+        builtinKernelParams(kernel,iterations,&j.params);
+        j.columns=n; j.thumb=thumb; j.width=width; j.height=height;
+        j.cStart[0]=cStart[0]; j.cStart[1]=cStart[1];
+        j.cStep[0]=step; j.cStep[1]=-step;
+        j.rgb=rgb;
+        double t0=nowSeconds();
+        runWorkers(cpuCount(),explorerWorker,&j);
+        seconds=nowSeconds()-t0;
+    }
+
+    printf("%d Julia sets of %dx%d in %.1f ms (%.0f per second)\n",n*n,thumb,thumb,seconds*1000.0,n*n/seconds);
+    printf("c of thumbnail (col,row) = (%.9g + col*%.9g, %.9g - row*%.9g)\n",cStart[0],step,cStart[1],step);
+    int ok=writePNG(out,rgb,width,height);
+    if(!ok) fprintf(stderr,"explore: cannot write %s\n",out);
+    free(rgb);
+    return ok ? 0 : 1;
+}
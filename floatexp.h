@@ -0,0 +1,74 @@
+// Extended-range floats for perturbation deltas below double's 1e-308 floor
+//
+// A floatexp is m * 2^e with 0.5 <= |m| < 1 (or m == 0) and a separate int
+// exponent. Every operation is a couple of double ops plus integer exponent
+// arithmetic, and normalization reads the exponent bits directly instead of
+// calling frexp. The remaining branches are on the data: zero in feNorm,
+// alignment in feAdd, range in feToDouble and the ordering in feLess.
+//
+// This is a scalar type, one value per struct. There is deliberately no SIMD
+// packet version: deep.c only runs floatexp for a pixel's first iterations
+// while its delta is below double range, one pixel at a time, and nucleus.c
+// only iterates a handful of values.
+#ifndef FLOATEXP_H
+#define FLOATEXP_H
+
+#include <string.h>
+
+typedef struct {
+    double m;
+    int e;
+} floatexp;
+
+#define FE_ZERO_EXP (-(1<<29))     // exponent of 0; sums of two stay in int range
+
+// Bits of 2^k for -1022 <= k <= 1023
+static inline double fePow2(int k){
+    unsigned long long u=(unsigned long long)(k+1023)<<52;
+    double d; memcpy(&d,&u,sizeof(d));
+    return d;
+}
+
+static inline floatexp feNorm(double m, int e){
+    unsigned long long u; memcpy(&u,&m,sizeof(u));
+    int be=(int)((u>>52)&0x7ff);
+    floatexp r;
+    if(be==0){ r.m=0.0; r.e=FE_ZERO_EXP; return r; }   // zero (deltas never go subnormal)
+    u=(u&0x800FFFFFFFFFFFFFull)|(1022ull<<52);
+    memcpy(&r.m,&u,sizeof(u));
+    r.e=e+be-1022;
+    return r;
+}
+
+static inline floatexp feFromDouble(double d){ return feNorm(d,0); }
+
+static inline double feToDouble(floatexp a){
+    if(a.e<-1074) return 0.0;
+    if(a.e>1024) return a.m*1e308*1e308;              // +-inf
+    if(a.e>1000) return a.m*fePow2(a.e-600)*fePow2(600);
+    if(a.e<-1000) return a.m*fePow2(a.e+600)*fePow2(-600);
+    return a.m*fePow2(a.e);
+}
+
+static inline floatexp feMul(floatexp a, floatexp b){ return feNorm(a.m*b.m,a.e+b.e); }
+static inline floatexp feMulD(floatexp a, double d){ return feNorm(a.m*d,a.e); }
+static inline floatexp feDiv(floatexp a, floatexp b){ return feNorm(a.m/b.m,a.e-b.e); }
+static inline floatexp feLdexp(floatexp a, int k){ a.e+=a.m!=0.0 ? k : 0; return a; }
+static inline floatexp feNeg(floatexp a){ a.m=-a.m; return a; }
+
+static inline floatexp feAdd(floatexp a, floatexp b){
+    if(a.e<b.e){ floatexp t=a; a=b; b=t; }
+    int d=a.e-b.e;
+    if(d>60) return a;
+    return feNorm(a.m+b.m*fePow2(-d),a.e);
+}
+static inline floatexp feSub(floatexp a, floatexp b){ return feAdd(a,feNeg(b)); }
+
+// |a|^2 + |b|^2 compared without leaving floatexp
+static inline floatexp feNorm2(floatexp re, floatexp im){ return feAdd(feMul(re,re),feMul(im,im)); }
+static inline int feLess(floatexp a, floatexp b){   // a < b for non-negative values
+    if(a.m==0.0 || b.m==0.0) return b.m!=0.0;
+    return a.e<b.e || (a.e==b.e && a.m<b.m);
+}
+
+#endif
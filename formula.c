@@ -0,0 +1,556 @@
+// Formula language: parser, GLSL and C emitters, and a packet interpreter
+//
+//   fractal.exe formula "<description>"|@file <out.frag|out.c|out.png> [WxH] [iterations] [cx cy scale]
+//
+// A description is parsed into a list of SSA ops (constants folded on the way).
+// The same list is then printed as a shader in the usual skeleton (uv -> c
+// mapping, escape loop, smooth coloring), printed as a C kernel on SIMD_WD-wide
+// packets with every op and integer power unrolled, or interpreted directly on
+// packets. PNG renders run the C kernel through jit.c and fall back to the
+// interpreter when no compiler is around.
+#include "fractal.h"
+#include "formula.h"
+#include "threads.h"
+#include "image.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// --- Parser ---
+typedef struct {
+    const char* s;
+    FormulaProgram* prog;
+    char* err;
+    int errSize;
+} Parser;
+
+static int parseFail(Parser* P, const char* msg){
+    if(P->err && !P->err[0]) snprintf(P->err,P->errSize,"%s at \"%.20s\"",msg,P->s);
+    return -1;
+}
+
+static void skipSpace(Parser* P){ while(isspace((unsigned char)*P->s)) P->s++; }
+
+static int accept(Parser* P, char ch){
+    skipSpace(P);
+    if(*P->s!=ch) return 0;
+    P->s++;
+    return 1;
+}
+
+// Evaluates op on constant operands at parse time, so the emitters and the
+// interpreter only ever see arithmetic on values that depend on z or c
+static void foldScalar(OpCode op, int n, double ar, double ai, double br, double bi, double* rr, double* ri){
+    double d, t;
+    switch(op){
+    case OP_ADD: *rr=ar+br; *ri=ai+bi; break;
+    case OP_SUB: *rr=ar-br; *ri=ai-bi; break;
+    case OP_MUL: *rr=ar*br-ai*bi; *ri=ar*bi+ai*br; break;
+    case OP_DIV: d=br*br+bi*bi; *rr=(ar*br+ai*bi)/d; *ri=(ai*br-ar*bi)/d; break;
+    case OP_NEG: *rr=-ar; *ri=-ai; break;
+    case OP_CONJ: *rr=ar; *ri=-ai; break;
+    case OP_ABS: *rr=fabs(ar); *ri=fabs(ai); break;
+    case OP_RE: *rr=ar; *ri=0.0; break;
+    case OP_IM: *rr=ai; *ri=0.0; break;
+    case OP_POW:
+        *rr=1.0; *ri=0.0;
+        for(int k=0;k<n;k++){ t=*rr*ar-*ri*ai; *ri=*rr*ai+*ri*ar; *rr=t; }
+        break;
+    default: *rr=ar; *ri=ai; break;
+    }
+}
+
+static int newOp(Parser* P, OpCode op, int a, int b, int n, double re, double im){
+    FormulaProgram* prog=P->prog;
+    if(prog->count==FORMULA_MAX_OPS) return parseFail(P,"formula too long");
+    Op* o=&prog->ops[prog->count];
+    o->op=op; o->a=a; o->b=b; o->n=n; o->re=re; o->im=im;
+    return prog->count++;
+}
+
+static int addConst(Parser* P, double re, double im){ return newOp(P,OP_CONST,-1,-1,0,re,im); }
+
+// Appends op(a,b), folding it into a constant when its operands are constant
+static int addOp(Parser* P, OpCode op, int a, int b, int n){
+    int binary = op>=OP_ADD && op<=OP_DIV;
+    if(a<0 || (binary && b<0)) return -1;
+    const Op* A=&P->prog->ops[a];
+    const Op* B = binary ? &P->prog->ops[b] : NULL;
+    if(A->op==OP_CONST && (!B || B->op==OP_CONST)){
+        double rr, ri;
+        foldScalar(op,n,A->re,A->im,B?B->re:0.0,B?B->im:0.0,&rr,&ri);
+        return addConst(P,rr,ri);
+    }
+    return newOp(P,op,a,binary?b:-1,n,0.0,0.0);
+}
+
+static int parseExpr(Parser* P);
+
+static int parsePrimary(Parser* P){
+    skipSpace(P);
+    if(accept(P,'(')){
+        int v=parseExpr(P);
+        if(v<0) return v;
+        if(!accept(P,')')) return parseFail(P,"expected ')'");
+        return v;
+    }
+    if(isdigit((unsigned char)*P->s) || *P->s=='.'){
+        char* end;
+        double v=strtod(P->s,&end);
+        P->s=end;
+        return addConst(P,v,0.0);
+    }
+    if(isalpha((unsigned char)*P->s)){
+        char name[16]; int len=0;
+        while(isalnum((unsigned char)*P->s) && len<15) name[len++]=*P->s++;
+        name[len]='\0';
+        if(strcmp(name,"z")==0) return newOp(P,OP_Z,-1,-1,0,0.0,0.0);
+        if(strcmp(name,"c")==0) return newOp(P,OP_C,-1,-1,0,0.0,0.0);
+        if(strcmp(name,"i")==0) return addConst(P,0.0,1.0);
+
+        static const struct { const char* name; OpCode op; } funcs[]={
+            {"conj",OP_CONJ},{"abs",OP_ABS},{"re",OP_RE},{"im",OP_IM}
+        };
+        for(int f=0;f<4;f++){
+            if(strcmp(name,funcs[f].name)!=0) continue;
+            if(!accept(P,'(')) return parseFail(P,"expected '(' after function");
+            int v=parseExpr(P);
+            if(v<0) return v;
+            if(!accept(P,')')) return parseFail(P,"expected ')'");
+            return addOp(P,funcs[f].op,v,-1,0);
+        }
+        return parseFail(P,"unknown name");
+    }
+    return parseFail(P,"expected a value");
+}
+
+static int parsePower(Parser* P){
+    int v=parsePrimary(P);
+    while(v>=0 && accept(P,'^')){
+        skipSpace(P);
+        char* end;
+        long n=strtol(P->s,&end,10);
+        if(end==P->s || n<1 || n>64) return parseFail(P,"exponent must be an integer in 1..64");
+        P->s=end;
+        if(n>1) v=addOp(P,OP_POW,v,-1,(int)n);
+    }
+    return v;
+}
+
+static int parseUnary(Parser* P){
+    if(accept(P,'-')){
+        int v=parseUnary(P);
+        return addOp(P,OP_NEG,v,-1,0);
+    }
+    accept(P,'+');
+    return parsePower(P);
+}
+
+static int parseTerm(Parser* P){
+    int v=parseUnary(P);
+    for(;;){
+        if(v<0) return v;
+        if(accept(P,'*')) v=addOp(P,OP_MUL,v,parseUnary(P),0);
+        else if(accept(P,'/')) v=addOp(P,OP_DIV,v,parseUnary(P),0);
+        else return v;
+    }
+}
+
+static int parseExpr(Parser* P){
+    int v=parseTerm(P);
+    for(;;){
+        if(v<0) return v;
+        if(accept(P,'+')) v=addOp(P,OP_ADD,v,parseTerm(P),0);
+        else if(accept(P,'-')) v=addOp(P,OP_SUB,v,parseTerm(P),0);
+        else return v;
+    }
+}
+
+static int parseNumber(Parser* P, double* out){
+    skipSpace(P);
+    char* end;
+    *out=strtod(P->s,&end);
+    if(end==P->s) return 0;
+    P->s=end;
+    return 1;
+}
+
+int parseFormula(const char* src, FormulaProgram* prog, char* err, int errSize){
+    memset(prog,0,sizeof(*prog));
+    prog->result=-1;
+    prog->bailout=4.0;
+    prog->power=0.0;
+    if(err && errSize) err[0]='\0';
+    if(strlen(src)>=sizeof(prog->source)){
+        if(err && errSize) snprintf(err,errSize,"description too long (at most %d bytes)",FORMULA_MAX_SOURCE-1);
+        return 0;
+    }
+    memcpy(prog->source,src,strlen(src)+1);
+
+    Parser P={src,prog,err,errSize};
+    for(;;){
+        skipSpace(&P);
+        if(!*P.s) break;
+        char key[16]; int len=0;
+        while(isalpha((unsigned char)*P.s) && len<15) key[len++]=*P.s++;
+        key[len]='\0';
+        if(!len || !accept(&P,'=')){ parseFail(&P,"expected '<name> ='"); return 0; }
+
+        if(strcmp(key,"z")==0){
+            prog->result=parseExpr(&P);
+            if(prog->result<0) return 0;
+        } else if(strcmp(key,"julia")==0){
+            prog->julia=1;
+            if(!parseNumber(&P,&prog->jr) || !accept(&P,',') || !parseNumber(&P,&prog->ji)){
+                parseFail(&P,"expected julia = <re>, <im>"); return 0;
+            }
+        } else if(strcmp(key,"bailout")==0 || strcmp(key,"power")==0){
+            double v;
+            if(!parseNumber(&P,&v) || v<=1.0){ parseFail(&P,"expected a number > 1"); return 0; }
+            if(key[0]=='b') prog->bailout=v; else prog->power=v;
+        } else {
+            parseFail(&P,"unknown statement"); return 0;
+        }
+        if(!accept(&P,';')){
+            skipSpace(&P);
+            if(*P.s){ parseFail(&P,"expected ';'"); return 0; }
+        }
+    }
+    if(prog->result<0){ if(err) snprintf(err,errSize,"missing 'z = ...'"); return 0; }
+    if(prog->ops[prog->result].op==OP_CONST){ if(err) snprintf(err,errSize,"z must depend on z or c"); return 0; }
+
+    // smooth coloring degree defaults to the largest power in the formula
+    if(prog->power==0.0){
+        prog->power=2.0;
+        for(int k=0;k<prog->count;k++)
+            if(prog->ops[k].op==OP_POW && prog->ops[k].n>prog->power) prog->power=prog->ops[k].n;
+    }
+    return 1;
+}
+
+// --- GLSL ---
+static void glslFloat(double v, char* buf, size_t n){
+    snprintf(buf,n,"%.9g",v);
+    if(!strpbrk(buf,".en")) strncat(buf,".0",n-strlen(buf)-1);
+}
+
+static void glslOperand(const FormulaProgram* prog, int k, char* buf, size_t n){
+    const Op* o=&prog->ops[k];
+    if(o->op==OP_Z) snprintf(buf,n,"z");
+    else if(o->op==OP_C) snprintf(buf,n,"c");
+    else if(o->op==OP_CONST){
+        char r[40], i[40];
+        glslFloat(o->re,r,sizeof(r)); glslFloat(o->im,i,sizeof(i));
+        snprintf(buf,n,"vec2(%s, %s)",r,i);
+    }
+    else snprintf(buf,n,"t%d",k);
+}
+
+static int isRealConst(const FormulaProgram* prog, int k){
+    return prog->ops[k].op==OP_CONST && prog->ops[k].im==0.0;
+}
+
+static int isImagConst(const FormulaProgram* prog, int k){
+    return prog->ops[k].op==OP_CONST && prog->ops[k].re==0.0;
+}
+
+// The description as a // comment, one per line of it: a newline in a
+// multi-statement description would otherwise end the comment early
+static void emitSourceComment(const FormulaProgram* prog, FILE* out){
+    fprintf(out,"// generated by fractal.exe formula from: ");
+    const char* end=prog->source+strlen(prog->source);
+    while(end>prog->source && isspace((unsigned char)end[-1])) end--;
+    for(const char* p=prog->source; p<end; p++){
+        if(*p=='\n') fprintf(out,"\n//   ");
+        else if(*p!='\r') fputc((unsigned char)*p<' ' ? ' ' : *p,out);
+    }
+    fputc('\n',out);
+}
+
+void emitGLSL(const FormulaProgram* prog, FILE* out){
+    char a[96], b[96], s[40], bail[40], lp[40];
+    glslFloat(prog->bailout,bail,sizeof(bail));
+    glslFloat(prog->power,lp,sizeof(lp));
+
+    fprintf(out,"#version 330 core\n");
+    emitSourceComment(prog,out);
+    fprintf(out,"layout(std140) uniform Params {\n"
+                "    vec2 u_center; float u_scale; int u_maxIter;\n"
+                "    vec2 u_param; int u_paramSet; int u_deMode; int u_histogram;\n};\n");
+    fprintf(out,"in vec2 uv;\nout vec4 FragColor;\n\n");
+    fprintf(out,"vec3 palette(float t){\n    return vec3(0.5 + 0.5*cos(6.28318*(t+vec3(0.0,0.33,0.67))));\n}\n\n");
+    fprintf(out,"vec2 c_mul(vec2 a, vec2 b){ return vec2(a.x*b.x - a.y*b.y, a.x*b.y + a.y*b.x); }\n");
+    fprintf(out,"vec2 c_div(vec2 a, vec2 b){ return vec2(a.x*b.x + a.y*b.y, a.y*b.x - a.x*b.y)/dot(b,b); }\n");
+    fprintf(out,"vec2 c_sqr(vec2 a){ return vec2(a.x*a.x - a.y*a.y, 2.0*a.x*a.y); }\n");
+    fprintf(out,"vec2 c_pow(vec2 a, int n){ vec2 r = a; for(int k=1;k<n;k++) r = c_mul(r,a); return r; }\n\n");
+
+    if(prog->julia){
+        fprintf(out,"#ifdef INSTANCE_PARAM\nflat in vec3 v_param;\nvec2 juliaParam(vec2 c){ return v_param.z != 0.0 ? v_param.xy : c; }\n");
+        fprintf(out,"#else\nvec2 juliaParam(vec2 c){ return u_paramSet != 0 ? u_param : c; }\n#endif\n\n");
+    }
+    fprintf(out,"void main(){\n");
+    fprintf(out,"    vec2 p = (uv - vec2(0.5))*u_scale*2.0 + u_center;\n");
+    if(prog->julia){
+        char jr[40], ji[40];
+        glslFloat(prog->jr,jr,sizeof(jr)); glslFloat(prog->ji,ji,sizeof(ji));
+        fprintf(out,"    vec2 c = juliaParam(vec2(%s, %s));\n    vec2 z = p;\n",jr,ji);
+    } else {
+        fprintf(out,"    vec2 c = p;\n    vec2 z = vec2(0.0);\n");
+    }
+    fprintf(out,"    int i;\n    for(i=0;i<u_maxIter;i++){\n");
+
+    for(int k=0;k<prog->count;k++){
+        const Op* o=&prog->ops[k];
+        if(o->op==OP_CONST || o->op==OP_Z || o->op==OP_C) continue;
+        glslOperand(prog,o->a,a,sizeof(a));
+        if(o->b>=0) glslOperand(prog,o->b,b,sizeof(b));
+        fprintf(out,"        vec2 t%d = ",k);
+        switch(o->op){
+        case OP_ADD: fprintf(out,"%s + %s",a,b); break;
+        case OP_SUB: fprintf(out,"%s - %s",a,b); break;
+        case OP_MUL:
+            if(isRealConst(prog,o->b)){ glslFloat(prog->ops[o->b].re,s,sizeof(s)); fprintf(out,"%s * %s",a,s); }
+            else if(isRealConst(prog,o->a)){ glslFloat(prog->ops[o->a].re,s,sizeof(s)); fprintf(out,"%s * %s",s,b); }
+            else fprintf(out,"c_mul(%s, %s)",a,b);
+            break;
+        case OP_DIV:
+            if(isRealConst(prog,o->b)){ glslFloat(prog->ops[o->b].re,s,sizeof(s)); fprintf(out,"%s / %s",a,s); }
+            else fprintf(out,"c_div(%s, %s)",a,b);
+            break;
+        case OP_NEG: fprintf(out,"-%s",a); break;
+        case OP_POW:
+            if(o->n==2) fprintf(out,"c_sqr(%s)",a);
+            else fprintf(out,"c_pow(%s, %d)",a,o->n);
+            break;
+        case OP_CONJ: fprintf(out,"vec2(%s.x, -%s.y)",a,a); break;
+        case OP_ABS: fprintf(out,"abs(%s)",a); break;
+        case OP_RE: fprintf(out,"vec2(%s.x, 0.0)",a); break;
+        case OP_IM: fprintf(out,"vec2(%s.y, 0.0)",a); break;
+        default: break;
+        }
+        fprintf(out,";\n");
+    }
+    glslOperand(prog,prog->result,a,sizeof(a));
+    fprintf(out,"        z = %s;\n",a);
+    fprintf(out,"        if(dot(z,z) > %s) break;\n    }\n",bail);
+    fprintf(out,"    if(i==u_maxIter) FragColor = vec4(0.0);\n    else {\n");
+    fprintf(out,"        float mu = float(i) + 1.0 - log(log(length(z)))/log(%s);\n",lp);
+    fprintf(out,"        FragColor = vec4(palette(mu/float(u_maxIter)),1.0);\n    }\n}\n");
+}
+
+// --- C kernel ---
+static void cOperand(const FormulaProgram* prog, int k, int imag, char* buf, size_t n){
+    const Op* o=&prog->ops[k];
+    if(o->op==OP_Z) snprintf(buf,n,imag?"zi":"zr");
+    else if(o->op==OP_C) snprintf(buf,n,imag?"ci":"cr");
+    else if(o->op==OP_CONST) snprintf(buf,n,"(%.17g)",imag?o->im:o->re);
+    else snprintf(buf,n,"t%d%c",k,imag?'i':'r');
+}
+
+// Unrolled binary exponentiation: squarings into tK_s*, products into tK_p*
+static void emitPowC(int k, const char* ar, const char* ai, int n, FILE* out){
+    char br[64], bi[64], pr[64], pi[64];     // operands are up to 48 (emitKernelC)
+    snprintf(br,sizeof(br),"%s",ar); snprintf(bi,sizeof(bi),"%s",ai);
+    int haveAcc=0, step=0;
+    for(int bit=0; n; bit++, n>>=1){
+        if(bit>0){
+            fprintf(out,"        vdouble t%d_s%dr=%s*%s-%s*%s, t%d_s%di=2.0*%s*%s;\n",k,bit,br,br,bi,bi,k,bit,br,bi);
+            snprintf(br,sizeof(br),"t%d_s%dr",k,bit); snprintf(bi,sizeof(bi),"t%d_s%di",k,bit);
+        }
+        if(!(n&1)) continue;
+        if(!haveAcc){
+            snprintf(pr,sizeof(pr),"%s",br); snprintf(pi,sizeof(pi),"%s",bi);
+            haveAcc=1;
+        } else {
+            fprintf(out,"        vdouble t%d_p%dr=%s*%s-%s*%s, t%d_p%di=%s*%s+%s*%s;\n",
+                    k,step,pr,br,pi,bi,k,step,pr,bi,pi,br);
+            snprintf(pr,sizeof(pr),"t%d_p%dr",k,step); snprintf(pi,sizeof(pi),"t%d_p%di",k,step);
+            step++;
+        }
+    }
+    fprintf(out,"        vdouble t%dr=%s, t%di=%s;\n",k,pr,k,pi);
+}
+
+void emitKernelC(const FormulaProgram* prog, const char* symbol, FILE* out){
+    char ar[48], ai[48], br[48], bi[48];
+    emitSourceComment(prog,out);
+    fprintf(out,"#include \"kernel.h\"\n\n");
+    fprintf(out,"void %s(const KernelParams* p, const double* x, const double* y, int* iter, double* r2){\n",symbol);
+    fprintf(out,"    vdouble px, py, zr, zi, cr, ci;\n");
+    fprintf(out,"    for(int k=0;k<SIMD_WD;k++){ px[k]=x[k]; py[k]=y[k]; }\n");
+    fprintf(out,"    if(p->julia){ zr=px; zi=py; cr=vsplatd(p->jr); ci=vsplatd(p->ji); }\n");
+    fprintf(out,"    else { zr=vsplatd(0.0); zi=zr; cr=px; ci=py; }\n");
+    fprintf(out,"    vlong count={0}, active=~count;\n");
+    fprintf(out,"    for(int n=0;n<p->maxIter;n++){\n");
+
+    for(int k=0;k<prog->count;k++){
+        const Op* o=&prog->ops[k];
+        if(o->op==OP_CONST || o->op==OP_Z || o->op==OP_C) continue;
+        cOperand(prog,o->a,0,ar,sizeof(ar)); cOperand(prog,o->a,1,ai,sizeof(ai));
+        if(o->b>=0){ cOperand(prog,o->b,0,br,sizeof(br)); cOperand(prog,o->b,1,bi,sizeof(bi)); }
+        switch(o->op){
+        case OP_ADD: fprintf(out,"        vdouble t%dr=%s+%s, t%di=%s+%s;\n",k,ar,br,k,ai,bi); break;
+        case OP_SUB: fprintf(out,"        vdouble t%dr=%s-%s, t%di=%s-%s;\n",k,ar,br,k,ai,bi); break;
+        case OP_MUL:
+            if(isRealConst(prog,o->b)) fprintf(out,"        vdouble t%dr=%s*%s, t%di=%s*%s;\n",k,ar,br,k,ai,br);
+            else if(isRealConst(prog,o->a)) fprintf(out,"        vdouble t%dr=%s*%s, t%di=%s*%s;\n",k,ar,br,k,ar,bi);
+            else if(isImagConst(prog,o->a)) fprintf(out,"        vdouble t%dr=-%s*%s, t%di=%s*%s;\n",k,ai,bi,k,ai,br);
+            else fprintf(out,"        vdouble t%dr=%s*%s-%s*%s, t%di=%s*%s+%s*%s;\n",k,ar,br,ai,bi,k,ar,bi,ai,br);
+            break;
+        case OP_DIV:
+            if(isRealConst(prog,o->b)) fprintf(out,"        vdouble t%dr=%s/%s, t%di=%s/%s;\n",k,ar,br,k,ai,br);
+            else {
+                fprintf(out,"        vdouble t%dd=%s*%s+%s*%s;\n",k,br,br,bi,bi);
+                fprintf(out,"        vdouble t%dr=(%s*%s+%s*%s)/t%dd, t%di=(%s*%s-%s*%s)/t%dd;\n",
+                        k,ar,br,ai,bi,k,k,ai,br,ar,bi,k);
+            }
+            break;
+        case OP_NEG: fprintf(out,"        vdouble t%dr=-%s, t%di=-%s;\n",k,ar,k,ai); break;
+        case OP_POW: emitPowC(k,ar,ai,o->n,out); break;
+        case OP_CONJ: fprintf(out,"        vdouble t%dr=%s, t%di=-%s;\n",k,ar,k,ai); break;
+        case OP_ABS: fprintf(out,"        vdouble t%dr=vabsd(%s), t%di=vabsd(%s);\n",k,ar,k,ai); break;
+        case OP_RE: fprintf(out,"        vdouble t%dr=%s, t%di=vsplatd(0.0);\n",k,ar,k); break;
+        case OP_IM: fprintf(out,"        vdouble t%dr=%s, t%di=vsplatd(0.0);\n",k,ai,k); break;
+        default: break;
+        }
+    }
+    cOperand(prog,prog->result,0,ar,sizeof(ar)); cOperand(prog,prog->result,1,ai,sizeof(ai));
+    fprintf(out,"        zr=vselectd(active,%s,zr); zi=vselectd(active,%s,zi);\n",ar,ai);
+    fprintf(out,"        active&=(zr*zr+zi*zi<=p->bailout);\n");
+    fprintf(out,"        count-=active;\n");
+    fprintf(out,"        if(!vanyl(active)) break;\n    }\n");
+    fprintf(out,"    vdouble m=zr*zr+zi*zi;\n");
+    fprintf(out,"    for(int k=0;k<SIMD_WD;k++){ iter[k]=(int)count[k]; r2[k]=m[k]; }\n}\n");
+}
+
+// --- Interpreter ---
+void formulaKernelParams(const FormulaProgram* prog, int maxIter, KernelParams* p){
+    memset(p,0,sizeof(*p));
+    p->julia=prog->julia; p->jr=prog->jr; p->ji=prog->ji;
+    p->maxIter=maxIter;
+    p->bailout=prog->bailout;
+    p->user=prog;
+}
+
+void interpretKernel(const KernelParams* p, const double* x, const double* y, int* iter, double* r2){
+    const FormulaProgram* prog=(const FormulaProgram*)p->user;
+    vdouble re[FORMULA_MAX_OPS], im[FORMULA_MAX_OPS];
+    vdouble px, py, zr, zi, cr, ci;
+    for(int k=0;k<SIMD_WD;k++){ px[k]=x[k]; py[k]=y[k]; }
+    if(p->julia){ zr=px; zi=py; cr=vsplatd(p->jr); ci=vsplatd(p->ji); }
+    else { zr=vsplatd(0.0); zi=zr; cr=px; ci=py; }
+    for(int k=0;k<prog->count;k++){
+        if(prog->ops[k].op==OP_CONST){ re[k]=vsplatd(prog->ops[k].re); im[k]=vsplatd(prog->ops[k].im); }
+        if(prog->ops[k].op==OP_C){ re[k]=cr; im[k]=ci; }
+    }
+
+    vlong count={0}, active=~count;
+    for(int n=0;n<p->maxIter;n++){
+        for(int k=0;k<prog->count;k++){
+            const Op* o=&prog->ops[k];
+            vdouble ar=re[o->a>=0?o->a:0], ai=im[o->a>=0?o->a:0];
+            vdouble br=re[o->b>=0?o->b:0], bi=im[o->b>=0?o->b:0], t;
+            switch(o->op){
+            case OP_Z: re[k]=zr; im[k]=zi; break;
+            case OP_ADD: re[k]=ar+br; im[k]=ai+bi; break;
+            case OP_SUB: re[k]=ar-br; im[k]=ai-bi; break;
+            case OP_MUL: re[k]=ar*br-ai*bi; im[k]=ar*bi+ai*br; break;
+            case OP_DIV: t=br*br+bi*bi; re[k]=(ar*br+ai*bi)/t; im[k]=(ai*br-ar*bi)/t; break;
+            case OP_NEG: re[k]=-ar; im[k]=-ai; break;
+            case OP_POW: {
+                vdouble rr=ar, ri=ai;
+                for(int e=1;e<o->n;e++){ t=rr*ar-ri*ai; ri=rr*ai+ri*ar; rr=t; }
+                re[k]=rr; im[k]=ri;
+                break;
+            }
+            case OP_CONJ: re[k]=ar; im[k]=-ai; break;
+            case OP_ABS: re[k]=vabsd(ar); im[k]=vabsd(ai); break;
+            case OP_RE: re[k]=ar; im[k]=vsplatd(0.0); break;
+            case OP_IM: re[k]=ai; im[k]=vsplatd(0.0); break;
+            default: break;
+            }
+        }
+        zr=vselectd(active,re[prog->result],zr);
+        zi=vselectd(active,im[prog->result],zi);
+        active&=(zr*zr+zi*zi<=p->bailout);
+        count-=active;
+        if(!vanyl(active)) break;
+    }
+    vdouble m=zr*zr+zi*zi;
+    for(int k=0;k<SIMD_WD;k++){ iter[k]=(int)count[k]; r2[k]=m[k]; }
+}
+
+// --- CLI ---
+static int endsWith(const char* s, const char* suffix){
+    size_t n=strlen(s), m=strlen(suffix);
+    return n>=m && strcmp(s+n-m,suffix)==0;
+}
+
+int formulaMain(int argc, char** argv){
+    if(argc<2){
+        printf("usage: fractal.exe formula \"<description>\"|@file <out.frag|out.c|out.png> [WxH] [iterations] [cx cy scale]\n");
+        printf("  e.g. \"z = conj(z)^2 + c\", \"z = (abs(re(z)) + i*im(z))^2 + c; julia = -0.4, 0.6\"\n");
+        return 1;
+    }
+    // "@file" reads the description from a file
+    static FormulaProgram prog;
+    char err[256];
+    char* file=NULL;
+    const char* desc=argv[0];
+    if(desc[0]=='@'){
+        file=tryLoadFile(desc+1);
+        if(!file){ fprintf(stderr,"formula: cannot read %s\n",desc+1); return 1; }
+        desc=file;
+    }
+    int parsed=parseFormula(desc,&prog,err,sizeof(err));
+    free(file);
+    if(!parsed){ fprintf(stderr,"formula: %s\n",err); return 1; }
+    const char* out=argv[1];
+
+    if(endsWith(out,".frag") || endsWith(out,".c")){
+        FILE* f=fopen(out,"w");
+        if(!f){ fprintf(stderr,"formula: cannot write %s\n",out); return 1; }
+        if(endsWith(out,".frag")) emitGLSL(&prog,f);
+        else {
+            // symbol from the file name: formulas/my-ship.c -> my_ship_kernel
+            char symbol[128]; int n=0;
+            const char* base=out;
+            for(const char* s=out;*s;s++) if(*s=='/' || *s=='\\') base=s+1;
+            for(const char* s=base; *s && *s!='.' && n<100; s++) symbol[n++]=isalnum((unsigned char)*s)?*s:'_';
+            if(!n || isdigit((unsigned char)symbol[0])) symbol[n++]='k';
+            strcpy(symbol+n,"_kernel");
+            emitKernelC(&prog,symbol,f);
+        }
+        fclose(f);
+        return 0;
+    }
+    if(!endsWith(out,".png")){ fprintf(stderr,"formula: output must be .frag, .c or .png\n"); return 1; }
+
+    View v={1920,1080, prog.julia?0.0:-0.5, 0.0, 1.5};
+    int iter=500;
+    if(argc>2) sscanf(argv[2],"%dx%d",&v.width,&v.height);
+    if(argc>3) iter=atoi(argv[3]);
+    if(argc>6){ v.cx=atof(argv[4]); v.cy=atof(argv[5]); v.scale=atof(argv[6]); }
+    if(v.width<1 || v.height<1 || iter<1){ fprintf(stderr,"formula: bad arguments\n"); return 1; }
+
+    // native code unless there's no compiler or FRACTAL_JIT=0
+    KernelParams kp;
+    formulaKernelParams(&prog,iter,&kp);
+    KernelFn fn=NULL;
+    int cached=0;
+    const char* jit=getenv("FRACTAL_JIT");
+    if(!jit || strcmp(jit,"0")!=0){
+        double t0=nowSeconds();
+        fn=jitFormulaKernel(&prog,&cached,err,sizeof(err));
+        if(fn) printf("jit: %s in %.3fs\n",cached?"loaded":"compiled",nowSeconds()-t0);
+        else fprintf(stderr,"jit: %s, interpreting\n",err);
+    }
+    unsigned char* rgb=(unsigned char*)malloc((size_t)v.width*v.height*3);
+    double dt=renderKernel(fn?fn:interpretKernel,&kp,&v,prog.power,rgb);
+    printf("%.3fs (%s, %d ops)\n",dt,fn?"native":"interpreted",prog.count);
+    int ok=writePNG(out,rgb,v.width,v.height);
+    if(!ok) fprintf(stderr,"formula: cannot write %s\n",out);
+    free(rgb);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+// Formula description language compiled to GLSL shaders and C packet kernels
+//
+//   z = conj(z)^2 + c
+//   z = (abs(re(z)) + i*im(z))^2 + c; julia = -0.4, 0.6
+//   z = z^3 + c; power = 3; bailout = 16
+//
+// Expressions are complex valued over z, c, i and real literals with + - * / ^n
+// (integer n >= 1) and conj, abs (per component), re, im. Optional statements set
+// Julia mode with its constant, the squared bailout and the degree used for
+// smooth coloring.
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include <stdio.h>
+#include "kernel.h"
+
+#define FORMULA_MAX_OPS 128
+#define FORMULA_MAX_SOURCE 4096     // longest description, in bytes
+
+typedef enum {
+    OP_CONST, OP_Z, OP_C,
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_NEG, OP_POW,
+    OP_CONJ, OP_ABS, OP_RE, OP_IM
+} OpCode;
+
+// One SSA value; operands refer to earlier ops
+typedef struct {
+    OpCode op;
+    int a, b;
+    int n;              // OP_POW exponent
+    double re, im;      // OP_CONST value
+} Op;
+
+typedef struct {
+    Op ops[FORMULA_MAX_OPS];
+    int count, result;
+    int julia;
+    double jr, ji, bailout, power;
+    char source[FORMULA_MAX_SOURCE];
+} FormulaProgram;
+
+// Returns 1 on success; otherwise writes a message to err (also when src is
+// FORMULA_MAX_SOURCE bytes or longer)
+int parseFormula(const char* src, FormulaProgram* prog, char* err, int errSize);
+
+// A complete .frag in the style of the hand-written shaders
+void emitGLSL(const FormulaProgram* prog, FILE* out);
+// A C translation unit defining `void <symbol>(...)` matching KernelFn
+void emitKernelC(const FormulaProgram* prog, const char* symbol, FILE* out);
+
+// KernelFn running prog (passed in KernelParams.user) on SIMD_WD lanes at a time
+void interpretKernel(const KernelParams* p, const double* x, const double* y, int* iter, double* r2);
+void formulaKernelParams(const FormulaProgram* prog, int maxIter, KernelParams* p);
+
+// --- JIT (jit.c) ---
+// Compiles prog to a native kernel (or reuses the jitcache/ copy; *cached tells
+// which). NULL with a message in err when no compiler is available.
+KernelFn jitFormulaKernel(const FormulaProgram* prog, int* cached, char* err, int errSize);
+
+#endif
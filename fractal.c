@@ -1,49 +1,68 @@
 // Fast interactive Mandelbrot using float shaders
-#include <windows.h>
-#include "glad.h"
+//
+// Windows builds use Win32 and WGL; elsewhere the window, context and input
+// come from GLFW (X11 or Wayland), with the same controls:
+//   drag pans, wheel zooms, D distance shading, H histogram coloring,
+//   +/- double or halve the iterations; FRACTAL_C=<re>,<im> sets the Julia c
+#include "fractal.h"
+#include "histogram.h"
+#include "threads.h"
 #include <stdio.h>
 #include <stdlib.h>
-
-LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+#include <string.h>
+#ifndef _WIN32
+#include <glob.h>
+#endif
 
 // --- Globals ---
-HDC hDC;
 double cx=-0.5, cy=0.0, scale=3.0;
-int width=800, height=600;
+int width=800, height=600;   // window size, kept current on resize
 int maxIter = 2;  // can increase for stills
-POINT lastMouse; int dragging=0;
+int deMode = 0;   // 'D' toggles distance-estimate shading
+int histMode = 0; // 'H' toggles histogram-equalized coloring
+#define CONE_BLOCK 8  // pixels per cone-prepass texel edge (menger.frag)
+#define ACCUM_FRAMES 64  // jittered frames averaged while the view is still
+#define POOL_STEP 256    // render targets grow in steps of this many pixels
+int lastMouseX, lastMouseY, dragging=0;
 
-char* loadFile(const char* filename) {
+char* tryLoadFile(const char* filename) {
     FILE* f = fopen(filename, "rb");
-    if (!f) {
-        MessageBoxA(NULL, filename, "Failed to open file", MB_OK);
-        ExitProcess(1);
-    }
+    if (!f) return NULL;
     fseek(f, 0, SEEK_END);
     long len = ftell(f);
     rewind(f);
 
     char* buffer = (char*)malloc(len + 1);
-    if (!buffer) {
-        MessageBoxA(NULL, "Out of memory", "Error", MB_OK);
-        ExitProcess(1);
-    }
+    if (!buffer) { fclose(f); return NULL; }
     fread(buffer, 1, len, f);
     buffer[len] = '\0';
     fclose(f);
     return buffer;
 }
 
-char* chooseShaderFile() {
-    WIN32_FIND_DATA fd;
-    HANDLE hFind = FindFirstFile("*.frag", &fd);
-    if (hFind == INVALID_HANDLE_VALUE) {
-        MessageBoxA(NULL, "No .frag files found", "Error", MB_OK);
-        ExitProcess(1);
-    }
+char* loadFile(const char* filename) {
+    char* buffer = tryLoadFile(filename);
+    if (!buffer) fatalError("Failed to open file", filename);
+    return buffer;
+}
+
+void fatalError(const char* title, const char* msg) {
+#ifdef _WIN32
+    MessageBoxA(NULL, msg, title, MB_OK);
+    ExitProcess(1);
+#else
+    fprintf(stderr, "%s: %s\n", title, msg);
+    exit(1);
+#endif
+}
 
+char* chooseShaderFile() {
     char files[64][MAX_PATH]; // up to 64 shaders
     int count = 0;
+#ifdef _WIN32
+    WIN32_FIND_DATA fd;
+    HANDLE hFind = FindFirstFile("*.frag", &fd);
+    if (hFind == INVALID_HANDLE_VALUE) fatalError("Error", "No .frag files found");
     do {
         if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
             strcpy(files[count++], fd.cFileName);
@@ -51,6 +70,14 @@ char* chooseShaderFile() {
         }
     } while (FindNextFile(hFind, &fd));
     FindClose(hFind);
+#else
+    glob_t g;
+    if (glob("*.frag", 0, NULL, &g) != 0) fatalError("Error", "No .frag files found");
+    for (size_t i = 0; i < g.gl_pathc && count < 64; i++) {
+        if (strlen(g.gl_pathv[i]) < MAX_PATH) strcpy(files[count++], g.gl_pathv[i]);
+    }
+    globfree(&g);
+#endif
 
     printf("Available fragment shaders:\n");
     for (int i = 0; i < count; i++) {
@@ -62,7 +89,7 @@ char* chooseShaderFile() {
     scanf("%d", &choice);
     if (choice < 1 || choice > count) choice = 1;
 
-    return _strdup(files[choice - 1]); // caller frees
+    return strdup(files[choice - 1]); // caller frees
 }
 
 // --- Shaders ---
@@ -70,8 +97,11 @@ const char* vertexShaderSource = R"(
 #version 330 core
 layout(location=0) in vec2 aPos;
 out vec2 uv;
+uniform vec2 u_jitter;  // subpixel offset in uv units, 0 unless accumulating
+uniform float u_aspect; // width/height: uv.x widens so pixels stay square; 0 keeps [0,1]
 void main() {
-    uv = aPos * 0.5 + 0.5;
+    float a = u_aspect > 0.0 ? u_aspect : 1.0;
+    uv = (aPos * 0.5 + u_jitter) * vec2(a, 1.0) + 0.5;
     gl_Position = vec4(aPos, 0.0, 1.0);
 }
 )";
@@ -82,7 +112,7 @@ GLuint compileShader(GLenum type,const char* src){
     glShaderSource(shader,1,&src,NULL);
     glCompileShader(shader);
     GLint ok; glGetShaderiv(shader,GL_COMPILE_STATUS,&ok);
-    if(!ok){ char log[1024]; glGetShaderInfoLog(shader,1024,NULL,log); MessageBoxA(NULL,log,"Shader error",MB_OK); ExitProcess(1);}
+    if(!ok){ char log[1024]; glGetShaderInfoLog(shader,1024,NULL,log); fatalError("Shader error",log);}
     return shader;
 }
 
@@ -93,38 +123,96 @@ GLuint createProgram(const char* vsSrc, const char* fsSrc){
     glAttachShader(prog,vs); glAttachShader(prog,fs);
     glLinkProgram(prog);
     GLint ok; glGetProgramiv(prog,GL_LINK_STATUS,&ok);
-    if(!ok){ char log[1024]; glGetProgramInfoLog(prog,1024,NULL,log); MessageBoxA(NULL,log,"Link error",MB_OK); ExitProcess(1);}
+    if(!ok){ char log[1024]; glGetProgramInfoLog(prog,1024,NULL,log); fatalError("Link error",log);}
     glDeleteShader(vs); glDeleteShader(fs);
     return prog;
 }
 
-// --- Main ---
-int main(){
-    printf("how many iterations? ");
-    scanf("%d", &maxIter);
-    char* fragSource = loadFile(chooseShaderFile());    
+// Same as createProgram but reports errors through log, for modes that must not exit
+GLuint tryCreateProgram(const char* vsSrc, const char* fsSrc, char* log, int logSize){
+    const char* srcs[2]={vsSrc,fsSrc};
+    GLenum types[2]={GL_VERTEX_SHADER,GL_FRAGMENT_SHADER};
+    GLuint shaders[2]={0,0};
+    GLint ok;
+    for(int i=0;i<2;i++){
+        shaders[i]=glCreateShader(types[i]);
+        glShaderSource(shaders[i],1,&srcs[i],NULL);
+        glCompileShader(shaders[i]);
+        glGetShaderiv(shaders[i],GL_COMPILE_STATUS,&ok);
+        if(!ok){
+            glGetShaderInfoLog(shaders[i],logSize,NULL,log);
+            glDeleteShader(shaders[0]); if(i) glDeleteShader(shaders[1]);
+            return 0;
+        }
+    }
+    GLuint prog=glCreateProgram();
+    glAttachShader(prog,shaders[0]); glAttachShader(prog,shaders[1]);
+    glLinkProgram(prog);
+    glDeleteShader(shaders[0]); glDeleteShader(shaders[1]);
+    glGetProgramiv(prog,GL_LINK_STATUS,&ok);
+    if(!ok){ glGetProgramInfoLog(prog,logSize,NULL,log); glDeleteProgram(prog); return 0; }
+    return prog;
+}
 
+// Copy of src with "#define <name>" right after its #version line
+char* shaderWithDefine(const char* src, const char* name){
+    const char* body=strchr(src,'\n');
+    body = body ? body+1 : src+strlen(src);
+    size_t head=body-src;
+    char* out=(char*)malloc(strlen(src)+strlen(name)+10);
+    memcpy(out,src,head);
+    sprintf(out+head,"#define %s\n",name);
+    strcat(out,body);
+    return out;
+}
 
-    WNDCLASSA wc={0}; wc.lpfnWndProc=WndProc;
-    wc.hInstance=GetModuleHandle(NULL); wc.lpszClassName="FractalWindow";
-    RegisterClassA(&wc);
-    HWND hwnd=CreateWindowA("FractalWindow","Mandelbrot",
-                            WS_OVERLAPPEDWINDOW|WS_VISIBLE,
-                            100,100,width,height,NULL,NULL,wc.hInstance,NULL);
+// Render targets follow the window but are only reallocated when it outgrows
+// them, rounded up to POOL_STEP, so dragging a window edge keeps reusing the
+// same textures; callers draw into the lower-left w x h corner. Returns 1 if
+// tex was reallocated.
+int growTexture(GLuint tex, GLenum internalFormat, GLenum format, GLenum type, int w, int h, int* capW, int* capH){
+    if(w<=*capW && h<=*capH) return 0;
+    if(w>*capW) *capW=(w+POOL_STEP-1)/POOL_STEP*POOL_STEP;
+    if(h>*capH) *capH=(h+POOL_STEP-1)/POOL_STEP*POOL_STEP;
+    glBindTexture(GL_TEXTURE_2D,tex);
+    glTexImage2D(GL_TEXTURE_2D,0,internalFormat,*capW,*capH,0,format,type,NULL);
+    return 1;
+}
 
-    hDC=GetDC(hwnd);
-    PIXELFORMATDESCRIPTOR pfd={sizeof(pfd),1};
-    pfd.dwFlags=PFD_DRAW_TO_WINDOW|PFD_SUPPORT_OPENGL|PFD_DOUBLEBUFFER;
-    pfd.iPixelType=PFD_TYPE_RGBA; pfd.cColorBits=32;
-    int pf=ChoosePixelFormat(hDC,&pfd); SetPixelFormat(hDC,pf,&pfd);
+// --- Shader parameters ---
+void paramsInit(ParamsBuffer* pb){
+    memset(&pb->current,0,sizeof(pb->current));
+    glGenBuffers(1,&pb->ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER,pb->ubo);
+    glBufferData(GL_UNIFORM_BUFFER,sizeof(ShaderParams),&pb->current,GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER,PARAMS_BINDING,pb->ubo);
+}
 
-    HGLRC hRC=wglCreateContext(hDC); wglMakeCurrent(hDC,hRC);
-    if(!gladLoadGL()){ MessageBoxA(NULL,"GLAD failed","Error",MB_OK); return 1; }
+void paramsFree(ParamsBuffer* pb){ glDeleteBuffers(1,&pb->ubo); }
 
-    GLuint program = createProgram(vertexShaderSource, fragSource);
-    glUseProgram(program);
+int paramsAttach(GLuint program){
+    GLuint block=glGetUniformBlockIndex(program,"Params");
+    if(block==GL_INVALID_INDEX) return 0;
+    glUniformBlockBinding(program,block,PARAMS_BINDING);
+    return 1;
+}
+
+int paramsUpdate(ParamsBuffer* pb, const ShaderParams* p){
+    if(memcmp(&pb->current,p,sizeof(ShaderParams))==0) return 0;
+    pb->current=*p;
+    glBindBuffer(GL_UNIFORM_BUFFER,pb->ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER,0,sizeof(ShaderParams),p);
+    return 1;
+}
 
-    // Quad
+void paramsDefaults(ShaderParams* p){
+    memset(p,0,sizeof(*p));
+    const char* s=getenv("FRACTAL_C");
+    if(s && sscanf(s,"%f,%f",&p->param[0],&p->param[1])==2) p->paramSet=1;
+}
+
+// Fullscreen quad drawn with glDrawElements(GL_TRIANGLES,6,...)
+GLuint createQuad(){
     float vertices[]={-1,-1,1,-1,1,1,-1,1};
     unsigned int indices[]={0,1,2,2,3,0};
     GLuint VAO,VBO,EBO;
@@ -133,54 +221,322 @@ int main(){
     glBindBuffer(GL_ARRAY_BUFFER,VBO); glBufferData(GL_ARRAY_BUFFER,sizeof(vertices),vertices,GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,EBO); glBufferData(GL_ELEMENT_ARRAY_BUFFER,sizeof(indices),indices,GL_STATIC_DRAW);
     glVertexAttribPointer(0,2,GL_FLOAT,GL_FALSE,2*sizeof(float),(void*)0); glEnableVertexAttribArray(0);
+    return VAO;
+}
+
+// --- Window ---
+#ifdef _WIN32
+LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+void createGLWindow(GLWindow* win, const char* title, int visible){
+    WNDCLASSA wc={0}; wc.lpfnWndProc=WndProc;
+    wc.hInstance=GetModuleHandle(NULL); wc.lpszClassName="FractalWindow";
+    RegisterClassA(&wc);
+    HWND hwnd=CreateWindowA("FractalWindow",title,
+                            WS_OVERLAPPEDWINDOW|(visible?WS_VISIBLE:0),
+                            100,100,width,height,NULL,NULL,wc.hInstance,NULL);
 
-    GLint loc_center=glGetUniformLocation(program,"u_center");
-    GLint loc_scale=glGetUniformLocation(program,"u_scale");
-    GLint loc_maxIter=glGetUniformLocation(program,"u_maxIter");
+    HDC dc=GetDC(hwnd);
+    PIXELFORMATDESCRIPTOR pfd={sizeof(pfd),1};
+    pfd.dwFlags=PFD_DRAW_TO_WINDOW|PFD_SUPPORT_OPENGL|PFD_DOUBLEBUFFER;
+    pfd.iPixelType=PFD_TYPE_RGBA; pfd.cColorBits=32;
+    int pf=ChoosePixelFormat(dc,&pfd); SetPixelFormat(dc,pf,&pfd);
+
+    HGLRC rc=wglCreateContext(dc); wglMakeCurrent(dc,rc);
+    if(!gladLoadGL()) fatalError("Error","GLAD failed");
+    win->hwnd=hwnd; win->dc=dc; win->rc=rc;
+}
+
+void destroyGLWindow(GLWindow* win){
+    wglMakeCurrent(NULL,NULL); wglDeleteContext(win->rc); ReleaseDC(win->hwnd,win->dc);
+}
 
+int pollGLWindow(GLWindow* win){
     MSG msg;
-    while(1){
-        while(PeekMessage(&msg,NULL,0,0,PM_REMOVE)){
-            if(msg.message==WM_QUIT) goto end;
-            TranslateMessage(&msg); DispatchMessage(&msg);
+    while(PeekMessage(&msg,NULL,0,0,PM_REMOVE)){
+        if(msg.message==WM_QUIT) return 0;
+        TranslateMessage(&msg); DispatchMessage(&msg);
+    }
+    return 1;
+}
+
+void swapGLWindow(GLWindow* win){ SwapBuffers(win->dc); }
+
+void glWindowSize(GLWindow* win, int* w, int* h){
+    RECT client; GetClientRect(win->hwnd,&client);
+    *w=client.right; *h=client.bottom;
+}
+#else
+static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods);
+static void cursorCallback(GLFWwindow* window, double x, double y);
+static void scrollCallback(GLFWwindow* window, double dx, double dy);
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+static void sizeCallback(GLFWwindow* window, int w, int h);
+
+// GL 3.3 core or newer: drivers hand back their latest core version, which
+// the compute mode checks for 4.3
+void createGLWindow(GLWindow* win, const char* title, int visible){
+    if(!glfwInit()) fatalError("Error","GLFW failed");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR,3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR,3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE,GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE,visible ? GLFW_TRUE : GLFW_FALSE);
+    GLFWwindow* window=glfwCreateWindow(width,height,title,NULL,NULL);
+    if(!window) fatalError("Error","No GL 3.3 window");
+    glfwMakeContextCurrent(window);
+    if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) fatalError("Error","GLAD failed");
+    glfwSetMouseButtonCallback(window,mouseButtonCallback);
+    glfwSetCursorPosCallback(window,cursorCallback);
+    glfwSetScrollCallback(window,scrollCallback);
+    glfwSetKeyCallback(window,keyCallback);
+    glfwSetWindowSizeCallback(window,sizeCallback);
+    win->window=window;
+}
+
+void destroyGLWindow(GLWindow* win){
+    glfwDestroyWindow(win->window);
+    glfwTerminate();
+}
+
+int pollGLWindow(GLWindow* win){
+    glfwPollEvents();
+    return !glfwWindowShouldClose(win->window);
+}
+
+void swapGLWindow(GLWindow* win){ glfwSwapBuffers(win->window); }
+
+void glWindowSize(GLWindow* win, int* w, int* h){ glfwGetFramebufferSize(win->window,w,h); }
+#endif
+
+// --- Main ---
+int main(int argc, char** argv){
+    // Headless modes: fractal.exe <mode> [args...]
+    if(argc>1 && strcmp(argv[1],"serve")==0) return tileServerMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"buddha")==0) return buddhabrotMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"de")==0) return distanceMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"menger")==0) return mengerMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"formula")==0) return formulaMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"cpu")==0) return cpuMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"deep")==0) return deepMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"deepview")==0) return deepViewMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"nucleus")==0) return nucleusMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"recolor")==0) return recolorMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"poster")==0) return posterMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"explore")==0) return explorerMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"atlas")==0) return atlasMain(argc-2, argv+2);
+    if(argc>1 && strcmp(argv[1],"compute")==0) return computeMain(argc-2, argv+2);
+
+    printf("how many iterations? ");
+    scanf("%d", &maxIter);
+    char* fragSource = loadFile(chooseShaderFile());    
+
+
+    GLWindow win;
+    createGLWindow(&win,"Mandelbrot",1);
+
+    GLuint program = createProgram(vertexShaderSource, fragSource);
+    glUseProgram(program);
+
+    GLuint VAO=createQuad();
+
+    // View, iterations and modes go through the Params block; only what is
+    // per-pass or per-program stays a plain uniform
+    ParamsBuffer params;
+    paramsInit(&params);
+    if(!paramsAttach(program)) fatalError("Shader","The shader declares no Params block (see fractal.h)");
+    ShaderParams sp;
+    paramsDefaults(&sp);
+    GLint loc_pass=glGetUniformLocation(program,"u_pass");
+    GLint loc_jitter=glGetUniformLocation(program,"u_jitter");
+    GLint loc_cdf=glGetUniformLocation(program,"u_cdf");
+    GLint loc_aspect=glGetUniformLocation(program,"u_aspect");
+    GLint loc_resolution=glGetUniformLocation(program,"u_resolution");
+
+    // Drawable size, picked up at the top of each frame; the targets below
+    // are sized there too
+    int fbWidth=0, fbHeight=0;
+
+    // Shaders with a u_pass uniform get a low-res cone prepass storing a safe
+    // starting t per CONE_BLOCK x CONE_BLOCK pixels in an R32F texture
+    GLuint coneFBO=0, coneTex=0;
+    int coneW=0, coneH=0, coneCapW=0, coneCapH=0;
+    if(loc_pass>=0){
+        glGenTextures(1,&coneTex);
+        glBindTexture(GL_TEXTURE_2D,coneTex);
+        glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+        glGenFramebuffers(1,&coneFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER,coneFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,coneTex,0);
+        glBindFramebuffer(GL_FRAMEBUFFER,0);
+        glUniform1i(glGetUniformLocation(program,"u_coneBlock"),CONE_BLOCK);
+        glUniform1i(glGetUniformLocation(program,"u_startDepth"),0);
+    }
+
+    // Frames are averaged into a float buffer: the first after any change
+    // replaces it, and while the view stays still each further one adds a
+    // sample at a new subpixel offset (R2 sequence) with weight 1/(n+1)
+    GLuint accumFBO, accumTex;
+    int accumCapW=0, accumCapH=0;
+    glGenTextures(1,&accumTex);
+    glBindTexture(GL_TEXTURE_2D,accumTex);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+    glGenFramebuffers(1,&accumFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER,accumFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,accumTex,0);
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+
+    // Shaders with a u_cdf sampler also write mu to a second output; the
+    // first frame after a change bins it and the next ones colour by its CDF
+    HistogramEq hist;
+    int histOK = loc_cdf>=0 && histInit(&hist,VAO);
+    const GLenum bothBuffers[2]={GL_COLOR_ATTACHMENT0,GL_COLOR_ATTACHMENT1};
+    if(histOK){
+        glBindFramebuffer(GL_FRAMEBUFFER,accumFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT1,GL_TEXTURE_2D,hist.muTex,0);
+        glBindFramebuffer(GL_FRAMEBUFFER,0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D,hist.cdfTex);
+        glActiveTexture(GL_TEXTURE0);
+        glUseProgram(program);
+        glUniform1i(loc_cdf,1);
+    }
+    int frame=0;
+
+    while(pollGLWindow(&win)){
+        int w, h;
+        glWindowSize(&win,&w,&h);
+        if(w<1 || h<1){ sleepMs(10); continue; }   // minimized
+        if(w!=fbWidth || h!=fbHeight){
+            fbWidth=w; fbHeight=h;
+            growTexture(accumTex,GL_RGBA32F,GL_RGBA,GL_FLOAT,w,h,&accumCapW,&accumCapH);
+            if(histOK) histResize(&hist,w,h);
+            if(coneFBO){
+                coneW=(w+CONE_BLOCK-1)/CONE_BLOCK; coneH=(h+CONE_BLOCK-1)/CONE_BLOCK;
+                growTexture(coneTex,GL_R32F,GL_RED,GL_FLOAT,coneW,coneH,&coneCapW,&coneCapH);
+            }
+            glUniform1f(loc_aspect,(float)w/h);
+            glUniform2f(loc_resolution,(float)w,(float)h);
+            frame=0;
         }
-        
 
-        glClear(GL_COLOR_BUFFER_BIT);
-        glUniform2f(loc_center,(float)cx,(float)cy);
-        glUniform1f(loc_scale,(float)scale);
-        glUniform1i(loc_maxIter,maxIter);
+        // an upload means something changed: restart the average
+        sp.center[0]=(float)cx; sp.center[1]=(float)cy;
+        sp.scale=(float)scale;
+        sp.maxIter=maxIter;
+        sp.deMode=deMode;
+        sp.histogram=histOK && histMode;
+        if(paramsUpdate(&params,&sp)) frame=0;
+
+        if(frame<ACCUM_FRAMES){
+            int useHist=sp.histogram;
+            double jx=0.0, jy=0.0;
+            if(frame>0){
+                jx=0.5+frame*0.7548776662466927; jy=0.5+frame*0.5698402909980532;
+                jx-=(int)jx+0.5; jy-=(int)jy+0.5;
+            }
+            glUniform2f(loc_jitter,(float)(jx/fbWidth),(float)(jy/fbHeight));
 
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
-        SwapBuffers(hDC);
+            glBindVertexArray(VAO);
+            if(coneFBO){
+                glBindFramebuffer(GL_FRAMEBUFFER,coneFBO);
+                glViewport(0,0,coneW,coneH);
+                glUniform1i(loc_pass,1);
+                glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+                glBindTexture(GL_TEXTURE_2D,coneTex);
+                glUniform1i(loc_pass,2);
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER,accumFBO);
+            glViewport(0,0,fbWidth,fbHeight);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_CONSTANT_ALPHA,GL_ONE_MINUS_CONSTANT_ALPHA);
+            // with the histogram on, frame 0 was coloured by the previous
+            // view's CDF, so frame 1 starts the average afresh
+            glBlendColor(0.0f,0.0f,0.0f,useHist && frame>0 ? 1.0f/frame : 1.0f/(frame+1));
+            if(useHist && frame==0) glDrawBuffers(2,bothBuffers);
+            glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+            glDisable(GL_BLEND);
+            if(useHist && frame==0){
+                glDrawBuffers(1,bothBuffers);
+                histUpdate(&hist,maxIter);
+                glUseProgram(program);
+            }
+            frame++;
+        } else sleepMs(10);   // converged; nothing new to draw
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER,accumFBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER,0);
+        glBlitFramebuffer(0,0,fbWidth,fbHeight,0,0,fbWidth,fbHeight,GL_COLOR_BUFFER_BIT,GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER,0);
+        swapGLWindow(&win);
     }
 
-end: 
+    glDeleteFramebuffers(1,&accumFBO); glDeleteTextures(1,&accumTex);
+    if(histOK) histFree(&hist);
+    paramsFree(&params);
     free(fragSource);
-    wglMakeCurrent(NULL,NULL); wglDeleteContext(hRC); ReleaseDC(hwnd,hDC);
+    destroyGLWindow(&win);
     return 0;
 }
 
 // --- Input ---
+// Both window backends translate their events into these
+static void viewPress(int x, int y){ dragging=1; lastMouseX=x; lastMouseY=y; }
+static void viewRelease(void){ dragging=0; }
+static void viewMove(int x, int y){
+    if(!dragging) return;
+    cx-=(x-lastMouseX)/(double)(height)*scale*2;   // square pixels
+    cy+=(y-lastMouseY)/(double)(height)*scale*2;
+    lastMouseX=x; lastMouseY=y;
+}
+static void viewWheel(int up){
+    if(up) scale*=0.9;
+    else scale/=0.9;
+}
+static void viewKey(int key){
+    if(key=='D') deMode=!deMode;
+    else if(key=='H') histMode=!histMode;
+    else if(key=='+') maxIter*=2;
+    else if(key=='-' && maxIter>1) maxIter/=2;
+}
+
+#ifdef _WIN32
 LRESULT CALLBACK WndProc(HWND hwnd,UINT msg,WPARAM wParam,LPARAM lParam){
     switch(msg){
-        case WM_LBUTTONDOWN: dragging=1; lastMouse.x=LOWORD(lParam); lastMouse.y=HIWORD(lParam); break;
-        case WM_LBUTTONUP: dragging=0; break;
-        case WM_MOUSEMOVE:
-            if(dragging){
-                int x=LOWORD(lParam),y=HIWORD(lParam);
-                cx-=(x-lastMouse.x)/(double)(width)*scale*2;
-                cy+=(y-lastMouse.y)/(double)(height)*scale*2;
-                lastMouse.x=x; lastMouse.y=y;
-            }
+        case WM_LBUTTONDOWN: viewPress(LOWORD(lParam),HIWORD(lParam)); break;
+        case WM_LBUTTONUP: viewRelease(); break;
+        case WM_MOUSEMOVE: viewMove(LOWORD(lParam),HIWORD(lParam)); break;
+        case WM_SIZE:
+            if(LOWORD(lParam)>0 && HIWORD(lParam)>0){ width=LOWORD(lParam); height=HIWORD(lParam); }
             break;
-        case WM_MOUSEWHEEL:
-            if(GET_WHEEL_DELTA_WPARAM(wParam)>0) scale*=0.9;
-            else scale/=0.9;
+        case WM_MOUSEWHEEL: viewWheel(GET_WHEEL_DELTA_WPARAM(wParam)>0); break;
+        case WM_KEYDOWN:
+            if(wParam==VK_ADD || wParam==VK_OEM_PLUS) viewKey('+');
+            else if(wParam==VK_SUBTRACT || wParam==VK_OEM_MINUS) viewKey('-');
+            else if(wParam>='A' && wParam<='Z') viewKey((int)wParam);
             break;
         case WM_DESTROY: PostQuitMessage(0); break;
         default: return DefWindowProc(hwnd,msg,wParam,lParam);
     }
     return 0;
 }
+#else
+static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods){
+    if(button!=GLFW_MOUSE_BUTTON_LEFT) return;
+    double x, y;
+    glfwGetCursorPos(window,&x,&y);
+    if(action==GLFW_PRESS) viewPress((int)x,(int)y);
+    else viewRelease();
+}
+// Window coordinates like the cursor; glWindowSize gives the pixels to draw
+static void sizeCallback(GLFWwindow* window, int w, int h){ if(w>0 && h>0){ width=w; height=h; } }
+static void cursorCallback(GLFWwindow* window, double x, double y){ viewMove((int)x,(int)y); }
+static void scrollCallback(GLFWwindow* window, double dx, double dy){ if(dy!=0.0) viewWheel(dy>0.0); }
+static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods){
+    if(action==GLFW_RELEASE) return;
+    if(key==GLFW_KEY_EQUAL || key==GLFW_KEY_KP_ADD) viewKey('+');
+    else if(key==GLFW_KEY_MINUS || key==GLFW_KEY_KP_SUBTRACT) viewKey('-');
+    else if(key>='A' && key<='Z') viewKey(key);   // GLFW letter keys are their ASCII capitals
+}
+#endif
@@ -0,0 +1,104 @@
+// Shared declarations between the interactive viewer and its headless modes
+#ifndef FRACTAL_H
+#define FRACTAL_H
+
+#ifdef _WIN32
+#include <windows.h>
+#include "glad.h"
+#else
+#include "glad.h"
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+#define MAX_PATH 260
+#endif
+
+extern const char* vertexShaderSource;
+
+// --- View state (fractal.c), moved by the window's mouse and keys ---
+extern double cx, cy, scale;
+extern int width, height;
+extern int maxIter;
+
+// --- Shader parameters: one std140 block shared by every fractal shader ---
+//
+//   layout(std140) uniform Params {
+//       vec2 u_center; float u_scale; int u_maxIter;
+//       vec2 u_param; int u_paramSet; int u_deMode; int u_histogram;
+//   };
+//
+// It lives in one uniform buffer at PARAMS_BINDING, so switching parameters
+// between draws or programs is a buffer update, never a recompile.
+#define PARAMS_BINDING 0
+typedef struct {
+    float center[2];
+    float scale;
+    int maxIter;
+    float param[2];     // formula parameter, e.g. the Julia c
+    int paramSet;       // 0: the shader keeps its own
+    int deMode;         // 1: distance-estimate shading
+    int histogram;      // 1: palette by the CDF in u_cdf (histogram.c)
+    int pad[3];         // std140 rounds the block up to 16 bytes
+} ShaderParams;
+
+typedef struct {
+    GLuint ubo;
+    ShaderParams current;   // what the buffer holds
+} ParamsBuffer;
+
+void paramsInit(ParamsBuffer* pb);
+void paramsFree(ParamsBuffer* pb);
+// Connects program's Params block to PARAMS_BINDING; returns 0 if it has none
+int paramsAttach(GLuint program);
+// Uploads p only if it differs from the buffer; returns 1 if it did
+int paramsUpdate(ParamsBuffer* pb, const ShaderParams* p);
+// Zeroed parameters, with u_param from FRACTAL_C=<re>,<im> when set
+void paramsDefaults(ShaderParams* p);
+
+// --- Window with a current GL context: Win32/WGL, or GLFW elsewhere ---
+typedef struct {
+#ifdef _WIN32
+    HWND hwnd;
+    HDC dc;
+    HGLRC rc;
+#else
+    GLFWwindow* window;
+#endif
+} GLWindow;
+
+// Hidden windows back the headless modes
+void createGLWindow(GLWindow* win, const char* title, int visible);
+void destroyGLWindow(GLWindow* win);
+// Handles pending input; returns 0 once the window has been closed
+int pollGLWindow(GLWindow* win);
+void swapGLWindow(GLWindow* win);
+// Drawable size in pixels
+void glWindowSize(GLWindow* win, int* w, int* h);
+// Message box on Windows, stderr elsewhere; then exits
+void fatalError(const char* title, const char* msg);
+
+char* loadFile(const char* filename);
+char* tryLoadFile(const char* filename);   // NULL instead of exiting
+GLuint compileShader(GLenum type,const char* src);
+GLuint createProgram(const char* vsSrc, const char* fsSrc);
+GLuint tryCreateProgram(const char* vsSrc, const char* fsSrc, char* log, int logSize);
+char* shaderWithDefine(const char* src, const char* name);
+GLuint createQuad();
+int growTexture(GLuint tex, GLenum internalFormat, GLenum format, GLenum type, int w, int h, int* capW, int* capH);
+
+// --- Modes ---
+int tileServerMain(int argc, char** argv);
+int buddhabrotMain(int argc, char** argv);
+int distanceMain(int argc, char** argv);
+int mengerMain(int argc, char** argv);
+int formulaMain(int argc, char** argv);
+int cpuMain(int argc, char** argv);
+int deepMain(int argc, char** argv);
+int deepViewMain(int argc, char** argv);
+int nucleusMain(int argc, char** argv);
+int recolorMain(int argc, char** argv);
+int posterMain(int argc, char** argv);
+int explorerMain(int argc, char** argv);
+int atlasMain(int argc, char** argv);
+int computeMain(int argc, char** argv);
+
+#endif
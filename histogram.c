@@ -0,0 +1,145 @@
+// Histogram-equalized coloring for the 2D fragment shaders
+//
+// Dividing mu by maxIter crowds the palette into the low end once the
+// iteration count is raised. Instead the shaders can look their palette
+// position up in the cumulative distribution of the frame's escape times:
+//
+//   1. the shader writes mu to a second colour output (muTex)
+//   2. one point per pixel, placed by gl_VertexID, lands in its log-spaced bin
+//      of an HIST_BINS x 1 float target with additive blending
+//   3. each texel of the CDF target sums the bins below its own
+//
+// Everything stays on the GPU, so the interactive loop never waits on a
+// readback; the shader colours with the distribution of the previous frame.
+//
+// Shader side (palette position for mu):
+//   t = u_histogram != 0 ? texture(u_cdf, vec2(log(1+mu)/log(1+maxIter), 0.5)).r
+//                        : mu/maxIter
+#include "fractal.h"
+#include "histogram.h"
+#include <stdlib.h>
+
+static const char* scatterVertexSource = R"(
+#version 330 core
+uniform sampler2D u_mu;
+uniform float u_maxIter;
+uniform int u_bins;
+uniform int u_width;        // of the image in the lower-left of u_mu
+void main() {
+    float mu = texelFetch(u_mu, ivec2(gl_VertexID % u_width, gl_VertexID / u_width), 0).r;
+    float t = clamp(log(1.0 + max(mu, 0.0))/log(1.0 + u_maxIter), 0.0, 1.0);
+    float bin = min(floor(t*float(u_bins)), float(u_bins - 1));
+    // bounded pixels land outside the viewport
+    gl_Position = vec4(mu < 0.0 ? 2.0 : (bin + 0.5)/float(u_bins)*2.0 - 1.0, 0.0, 0.0, 1.0);
+}
+)";
+
+static const char* scatterFragmentSource = R"(
+#version 330 core
+out vec4 FragColor;
+void main() { FragColor = vec4(1.0); }
+)";
+
+static const char* cdfFragmentSource = R"(
+#version 330 core
+uniform sampler2D u_hist;
+out vec4 FragColor;
+void main() {
+    int bins = textureSize(u_hist, 0).x;
+    int bin = int(gl_FragCoord.x);
+    float below = 0.0, total = 0.0;
+    for (int i = 0; i < bins; i++) {
+        float n = texelFetch(u_hist, ivec2(i, 0), 0).r;
+        total += n;
+        if (i < bin) below += n;
+    }
+    float own = texelFetch(u_hist, ivec2(bin, 0), 0).r;
+    // value at the bin centre; the identity when nothing escaped
+    FragColor = vec4(total > 0.0 ? (below + 0.5*own)/total : (float(bin) + 0.5)/float(bins));
+}
+)";
+
+static GLuint binTarget(GLuint* fbo, GLenum filter){
+    GLuint tex;
+    glGenTextures(1,&tex);
+    glBindTexture(GL_TEXTURE_2D,tex);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_R32F,HIST_BINS,1,0,GL_RED,GL_FLOAT,NULL);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,filter);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,filter);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
+    glGenFramebuffers(1,fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER,*fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,tex,0);
+    return tex;
+}
+
+int histInit(HistogramEq* h, GLuint vao){
+    h->width=0; h->height=0; h->capW=0; h->capH=0; h->vao=vao;
+    glGenTextures(1,&h->muTex);
+    glBindTexture(GL_TEXTURE_2D,h->muTex);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
+
+    h->histTex=binTarget(&h->histFBO,GL_NEAREST);
+    int ok=glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE;
+    h->cdfTex=binTarget(&h->cdfFBO,GL_LINEAR);
+    // identity until the first update
+    float* ramp=(float*)malloc(HIST_BINS*sizeof(float));
+    for(int i=0;i<HIST_BINS;i++) ramp[i]=(i+0.5f)/HIST_BINS;
+    glTexSubImage2D(GL_TEXTURE_2D,0,0,0,HIST_BINS,1,GL_RED,GL_FLOAT,ramp);
+    free(ramp);
+    ok&=glCheckFramebufferStatus(GL_FRAMEBUFFER)==GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+
+    h->scatterProgram=createProgram(scatterVertexSource,scatterFragmentSource);
+    h->locMaxIter=glGetUniformLocation(h->scatterProgram,"u_maxIter");
+    h->locWidth=glGetUniformLocation(h->scatterProgram,"u_width");
+    glUseProgram(h->scatterProgram);
+    glUniform1i(glGetUniformLocation(h->scatterProgram,"u_bins"),HIST_BINS);
+    h->cdfProgram=createProgram(vertexShaderSource,cdfFragmentSource);
+    glGenVertexArrays(1,&h->pointVAO);
+    return ok;
+}
+
+void histResize(HistogramEq* h, int width, int height){
+    h->width=width; h->height=height;
+    growTexture(h->muTex,GL_R32F,GL_RED,GL_FLOAT,width,height,&h->capW,&h->capH);
+}
+
+void histFree(HistogramEq* h){
+    glDeleteTextures(1,&h->muTex);
+    glDeleteFramebuffers(1,&h->histFBO); glDeleteTextures(1,&h->histTex);
+    glDeleteFramebuffers(1,&h->cdfFBO); glDeleteTextures(1,&h->cdfTex);
+    glDeleteProgram(h->scatterProgram); glDeleteProgram(h->cdfProgram);
+    glDeleteVertexArrays(1,&h->pointVAO);
+}
+
+void histUpdate(HistogramEq* h, int maxIter){
+    glViewport(0,0,HIST_BINS,1);
+    glActiveTexture(GL_TEXTURE0);
+
+    // 2. count
+    glBindFramebuffer(GL_FRAMEBUFFER,h->histFBO);
+    glClearColor(0.0f,0.0f,0.0f,0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glUseProgram(h->scatterProgram);
+    glUniform1f(h->locMaxIter,(float)maxIter);
+    glUniform1i(h->locWidth,h->width);
+    glBindTexture(GL_TEXTURE_2D,h->muTex);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE,GL_ONE);
+    glBindVertexArray(h->pointVAO);
+    glDrawArrays(GL_POINTS,0,h->width*h->height);
+    glDisable(GL_BLEND);
+
+    // 3. accumulate
+    glBindFramebuffer(GL_FRAMEBUFFER,h->cdfFBO);
+    glUseProgram(h->cdfProgram);
+    glBindTexture(GL_TEXTURE_2D,h->histTex);
+    glBindVertexArray(h->vao);
+    glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER,0);
+    glViewport(0,0,h->width,h->height);
+}
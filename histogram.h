@@ -0,0 +1,30 @@
+// Histogram-equalized coloring for the 2D fragment shaders
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "glad.h"
+
+#define HIST_BINS 1024      // log-spaced over 0..maxIter
+
+typedef struct {
+    int width, height;              // pixels of muTex in use
+    int capW, capH;
+    GLuint muTex;                   // R32F smooth iteration count, -1 inside
+    GLuint histFBO, histTex;        // HIST_BINS x 1 counts
+    GLuint cdfFBO, cdfTex;          // HIST_BINS x 1 cumulative distribution
+    GLuint scatterProgram, cdfProgram;
+    GLint locMaxIter, locWidth;
+    GLuint vao;                     // full-screen quad
+    GLuint pointVAO;                // empty; points come from gl_VertexID
+} HistogramEq;
+
+int histInit(HistogramEq* h, GLuint vao);
+// Sets the image size, growing muTex in POOL_STEP steps (growTexture)
+void histResize(HistogramEq* h, int width, int height);
+void histFree(HistogramEq* h);
+// Bins h->muTex (written by the shader as a second colour output) and rebuilds
+// the cumulative distribution, all on the GPU. Leaves the default framebuffer
+// bound; the caller rebinds its own program.
+void histUpdate(HistogramEq* h, int maxIter);
+
+#endif
@@ -0,0 +1,263 @@
+// PNG writer using stored (uncompressed) deflate blocks, so no zlib is needed
+#include "image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int crcTable[256];
+static int crcReady=0;
+
+static unsigned int crc32Update(unsigned int crc, const unsigned char* p, size_t n){
+    if(!crcReady){
+        for(unsigned int i=0;i<256;i++){
+            unsigned int c=i;
+            for(int k=0;k<8;k++) c = (c&1) ? 0xEDB88320u^(c>>1) : c>>1;
+            crcTable[i]=c;
+        }
+        crcReady=1;
+    }
+    crc=~crc;
+    while(n--) crc=crcTable[(crc^*p++)&0xFF]^(crc>>8);
+    return ~crc;
+}
+
+static void put32(unsigned char* p, unsigned int v){
+    p[0]=v>>24; p[1]=v>>16; p[2]=v>>8; p[3]=v;
+}
+
+// Writes one chunk at out: length, type, data, crc. Returns bytes written.
+static size_t putChunk(unsigned char* out, const char* type, const unsigned char* data, size_t len){
+    put32(out,(unsigned int)len);
+    memcpy(out+4,type,4);
+    if(len) memcpy(out+8,data,len);
+    put32(out+8+len,crc32Update(0,out+4,len+4));
+    return len+12;
+}
+
+unsigned char* encodePNG(const unsigned char* rgb, int w, int h, size_t* outSize){
+    size_t rowBytes=(size_t)w*3+1;              // filter byte + pixels
+    size_t raw=rowBytes*h;
+    size_t blocks=(raw+65534)/65535; if(!blocks) blocks=1;
+    size_t zlen=2+raw+blocks*5+4;               // header, stored blocks, adler32
+
+    unsigned char* z=(unsigned char*)malloc(zlen);
+    unsigned char* png=(unsigned char*)malloc(8+25+zlen+12+12);
+    if(!z || !png){ free(z); free(png); return NULL; }
+
+    // zlib stream of stored blocks, filter type 0 on every row
+    size_t zp=0, done=0;
+    unsigned int a=1, b=0;
+    z[zp++]=0x78; z[zp++]=0x01;
+    int row=0; size_t col=0;
+    do{
+        size_t n=raw-done; if(n>65535) n=65535;
+        z[zp++]=(done+n==raw);
+        z[zp++]=n&0xFF; z[zp++]=n>>8;
+        z[zp++]=~n&0xFF; z[zp++]=(~n>>8)&0xFF;
+        for(size_t i=0;i<n;i++){
+            unsigned char v = col==0 ? 0 : rgb[(size_t)row*w*3+col-1];
+            z[zp++]=v;
+            a=(a+v)%65521; b=(b+a)%65521;
+            if(++col==rowBytes){ col=0; row++; }
+        }
+        done+=n;
+    }while(done<raw);
+    put32(z+zp,(b<<16)|a); zp+=4;
+
+    static const unsigned char sig[8]={137,80,78,71,13,10,26,10};
+    unsigned char ihdr[13];
+    put32(ihdr,w); put32(ihdr+4,h);
+    ihdr[8]=8; ihdr[9]=2; ihdr[10]=0; ihdr[11]=0; ihdr[12]=0;  // 8-bit RGB
+
+    size_t p=0;
+    memcpy(png,sig,8); p+=8;
+    p+=putChunk(png+p,"IHDR",ihdr,13);
+    p+=putChunk(png+p,"IDAT",z,zp);
+    p+=putChunk(png+p,"IEND",NULL,0);
+    free(z);
+    *outSize=p;
+    return png;
+}
+
+int writePNG(const char* path, const unsigned char* rgb, int w, int h){
+    size_t size;
+    unsigned char* png=encodePNG(rgb,w,h,&size);
+    if(!png) return 0;
+    FILE* f=fopen(path,"wb");
+    if(!f){ free(png); return 0; }
+    int ok = fwrite(png,1,size,f)==size;
+    fclose(f);
+    free(png);
+    return ok;
+}
+
+// --- Streaming PNG ---
+// Each call adds one IDAT chunk of stored blocks covering whole rows; the zlib
+// header opens the first chunk and the Adler-32 closes the last.
+#define PNG_CHUNK_ROWS_BYTES (1u<<30)  // keeps chunk lengths well under 2^31
+
+static void putLE16(unsigned char* p, unsigned int v){ p[0]=v; p[1]=v>>8; }
+static void putLE32(unsigned char* p, unsigned int v){ p[0]=v; p[1]=v>>8; p[2]=v>>16; p[3]=v>>24; }
+static void putLE64(unsigned char* p, unsigned long long v){ putLE32(p,(unsigned int)v); putLE32(p+4,(unsigned int)(v>>32)); }
+
+static int pngOut(PngWriter* w, const unsigned char* p, size_t n){
+    w->crc=crc32Update(w->crc,p,n);
+    return fwrite(p,1,n,w->f)==n;
+}
+
+int pngWriterOpen(PngWriter* w, const char* path, int width, int height){
+    memset(w,0,sizeof(*w));
+    if(width<1 || height<1 || (size_t)width*3+1>PNG_CHUNK_ROWS_BYTES) return 0;
+    w->f=fopen(path,"wb");
+    if(!w->f) return 0;
+    w->width=width; w->height=height;
+    w->adlerA=1; w->adlerB=0;
+    static const unsigned char sig[8]={137,80,78,71,13,10,26,10};
+    unsigned char ihdr[13], chunk[25];
+    put32(ihdr,width); put32(ihdr+4,height);
+    ihdr[8]=8; ihdr[9]=2; ihdr[10]=0; ihdr[11]=0; ihdr[12]=0;
+    size_t n=putChunk(chunk,"IHDR",ihdr,13);
+    w->ok=fwrite(sig,1,8,w->f)==8 && fwrite(chunk,1,n,w->f)==n;
+    return w->ok;
+}
+
+static void pngWriteChunkRows(PngWriter* w, const unsigned char* rgb, int rows){
+    size_t rowBytes=(size_t)w->width*3+1, raw=rowBytes*rows;
+    size_t blocks=(raw+65534)/65535;
+    int first=w->row==0, last=w->row+rows==w->height;
+    size_t len=raw+blocks*5+(first?2:0)+(last?4:0);
+    unsigned char head[8], block[5];
+    put32(head,(unsigned int)len); memcpy(head+4,"IDAT",4);
+    w->ok&=fwrite(head,1,4,w->f)==4;
+    w->crc=0;
+    w->ok&=pngOut(w,head+4,4);
+    if(first){ static const unsigned char zhead[2]={0x78,0x01}; w->ok&=pngOut(w,zhead,2); }
+
+    // rows as stored blocks, a filter byte of 0 before each
+    size_t done=0, col=0;
+    const unsigned char* src=rgb;
+    while(done<raw){
+        size_t n=raw-done; if(n>65535) n=65535;
+        block[0]=last && done+n==raw;
+        putLE16(block+1,(unsigned int)n); putLE16(block+3,(unsigned int)~n&0xFFFF);
+        w->ok&=pngOut(w,block,5);
+        for(size_t left=n; left; ){
+            size_t k;
+            if(col==0){ static const unsigned char zero=0; k=1; w->ok&=pngOut(w,&zero,1); w->adlerB=(w->adlerB+w->adlerA)%65521; }
+            else {
+                k=rowBytes-col; if(k>left) k=left;
+                w->ok&=pngOut(w,src,k);
+                for(size_t i=0;i<k;i++){ w->adlerA=(w->adlerA+src[i])%65521; w->adlerB=(w->adlerB+w->adlerA)%65521; }
+                src+=k;
+            }
+            col+=k; if(col==rowBytes) col=0;
+            left-=k;
+        }
+        done+=n;
+    }
+    if(last){
+        unsigned char adler[4];
+        put32(adler,(w->adlerB<<16)|w->adlerA);
+        w->ok&=pngOut(w,adler,4);
+    }
+    unsigned char crc[4];
+    put32(crc,w->crc);
+    w->ok&=fwrite(crc,1,4,w->f)==4;
+    w->row+=rows;
+}
+
+int pngWriterRows(PngWriter* w, const unsigned char* rgb, int rows){
+    if(rows<1 || w->row+rows>w->height) return 0;
+    int per=(int)(PNG_CHUNK_ROWS_BYTES/((size_t)w->width*3+1));
+    while(rows>0){
+        int n=rows<per ? rows : per;
+        pngWriteChunkRows(w,rgb,n);
+        rgb+=(size_t)n*w->width*3;
+        rows-=n;
+    }
+    return w->ok;
+}
+
+int pngWriterClose(PngWriter* w){
+    int ok=w->ok && w->row==w->height;
+    if(w->f){
+        unsigned char iend[12];
+        size_t n=putChunk(iend,"IEND",NULL,0);
+        ok&=fwrite(iend,1,n,w->f)==n;
+        ok&=fclose(w->f)==0;
+    }
+    memset(w,0,sizeof(*w));
+    return ok;
+}
+
+// --- Tiled BigTIFF ---
+// Uncompressed tiles of equal size, so every offset is known up front: the
+// header, one IFD and the offset/byte-count tables are written on open and
+// tiles are then appended in raster order without seeking.
+#define TIFF_IFD_ENTRIES 11
+
+static void tiffEntry(unsigned char* e, int tag, int type, unsigned long long count, unsigned long long value){
+    putLE16(e,tag); putLE16(e+2,type); putLE64(e+4,count);
+    memset(e+12,0,8);
+    if(type==3 && count==1) putLE16(e+12,(unsigned int)value);
+    else putLE64(e+12,value);
+}
+
+int tiffWriterOpen(TiffWriter* w, const char* path, int width, int height, int tile){
+    memset(w,0,sizeof(*w));
+    if(width<1 || height<1 || tile<16 || tile%16) return 0;
+    w->f=fopen(path,"wb");
+    if(!w->f) return 0;
+    w->width=width; w->height=height; w->tile=tile;
+    w->tilesX=(width+tile-1)/tile; w->tilesY=(height+tile-1)/tile;
+    unsigned long long tiles=(unsigned long long)w->tilesX*w->tilesY;
+    unsigned long long tileBytes=(unsigned long long)tile*tile*3;
+    unsigned long long ifd=16, ifdSize=8+TIFF_IFD_ENTRIES*20+8;
+    unsigned long long offsets=(ifd+ifdSize+7)&~7ull, counts=offsets+tiles*8;
+    unsigned long long data=counts+tiles*8;
+
+    unsigned char head[16+8+TIFF_IFD_ENTRIES*20+8+8]={0};
+    memcpy(head,"II",2); putLE16(head+2,43); putLE16(head+4,8); putLE64(head+8,ifd);
+    unsigned char* p=head+16;
+    putLE64(p,TIFF_IFD_ENTRIES); p+=8;
+    tiffEntry(p,256,4,1,width); p+=20;             // ImageWidth
+    tiffEntry(p,257,4,1,height); p+=20;            // ImageLength
+    tiffEntry(p,258,3,3,0x0000000800080008ull); p+=20;      // BitsPerSample 8,8,8
+    tiffEntry(p,259,3,1,1); p+=20;                 // Compression: none
+    tiffEntry(p,262,3,1,2); p+=20;                 // Photometric: RGB
+    tiffEntry(p,277,3,1,3); p+=20;                 // SamplesPerPixel
+    tiffEntry(p,284,3,1,1); p+=20;                 // PlanarConfiguration: chunky
+    tiffEntry(p,322,4,1,tile); p+=20;              // TileWidth
+    tiffEntry(p,323,4,1,tile); p+=20;              // TileLength
+    tiffEntry(p,324,16,tiles,tiles>1 ? offsets : data); p+=20;     // TileOffsets
+    tiffEntry(p,325,16,tiles,tiles>1 ? counts : tileBytes); p+=20; // TileByteCounts
+    putLE64(p,0); p+=8;                            // no next IFD
+    size_t headSize=(size_t)offsets;
+    w->ok=fwrite(head,1,headSize,w->f)==headSize;
+
+    // both tables, streamed a slice at a time (a single tile's are inline in
+    // the IFD, and these 16 bytes just pad up to the data)
+    unsigned char buf[8*1024];
+    for(int table=0;table<2;table++)
+        for(unsigned long long t=0;t<tiles;){
+            size_t n=0;
+            for(;n<sizeof(buf)/8 && t<tiles;n++,t++) putLE64(buf+n*8,table ? tileBytes : data+t*tileBytes);
+            w->ok&=fwrite(buf,8,n,w->f)==n;
+        }
+    return w->ok;
+}
+
+int tiffWriterTile(TiffWriter* w, const unsigned char* rgb){
+    if(w->next>=w->tilesX*w->tilesY) return 0;
+    size_t n=(size_t)w->tile*w->tile*3;
+    w->ok&=fwrite(rgb,1,n,w->f)==n;
+    w->next++;
+    return w->ok;
+}
+
+int tiffWriterClose(TiffWriter* w){
+    int ok=w->ok && w->next==w->tilesX*w->tilesY;
+    if(w->f) ok&=fclose(w->f)==0;
+    memset(w,0,sizeof(*w));
+    return ok;
+}
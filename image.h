@@ -0,0 +1,38 @@
+// Dependency-free image output for the headless modes
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Encodes 8-bit RGB rows (top row first) as a PNG; caller frees the result
+unsigned char* encodePNG(const unsigned char* rgb, int w, int h, size_t* outSize);
+int writePNG(const char* path, const unsigned char* rgb, int w, int h);
+
+// --- Streaming writers for images larger than memory ---
+// PNG fed a band of whole rows (top row first) at a time
+typedef struct {
+    FILE* f;
+    int width, height, row;
+    unsigned int crc, adlerA, adlerB;
+    int ok;
+} PngWriter;
+
+int pngWriterOpen(PngWriter* w, const char* path, int width, int height);
+int pngWriterRows(PngWriter* w, const unsigned char* rgb, int rows);
+int pngWriterClose(PngWriter* w);     // 0 on any write error or missing rows
+
+// Tiled uncompressed RGB BigTIFF fed tile*tile tiles in raster order; edge
+// tiles are full size with the part outside the image ignored
+typedef struct {
+    FILE* f;
+    int width, height, tile, tilesX, tilesY;
+    int next;
+    int ok;
+} TiffWriter;
+
+int tiffWriterOpen(TiffWriter* w, const char* path, int width, int height, int tile);
+int tiffWriterTile(TiffWriter* w, const unsigned char* rgb);
+int tiffWriterClose(TiffWriter* w);
+
+#endif
@@ -0,0 +1,391 @@
+// Compact iteration data files and the recolor mode that reads them
+//
+//   fractal.exe recolor <in.fit> <out.png>
+//
+// Layout: a 40-byte header, tilesX*tilesY+1 little-endian 64-bit offsets
+// (the last one is the file size), then the tiles in row-major order.
+//
+// Within a tile each code is predicted from its left (a), upper (b) and
+// upper-left (c) neighbours with the LOCO-I median edge detector
+//
+//   pred = min(a,b) if c >= max(a,b), max(a,b) if c <= min(a,b), else a+b-c
+//
+// and the zigzagged residual is Rice coded with k adapted to the running mean
+// of recent residuals, as in JPEG-LS. Smooth bands cost a few bits per pixel;
+// very large residuals (tile corners, set boundaries) escape to an explicit
+// bit length after RICE_LIMIT ones. Tiles are encoded and decoded in parallel.
+#include "fractal.h"
+#include "iterdata.h"
+#include "threads.h"
+#include "image.h"
+#include "kernel.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ITER_MAGIC "FITD1\0\0"
+#define ITER_CODE_BASE 2        // codes 0 and 1 are mu = -1 (bounded) and -2 (glitched)
+#define RICE_LIMIT 32
+
+typedef struct {
+    char magic[8];
+    unsigned int width, height, tile, fracBits;
+    float lo, hi;
+    unsigned int reserved[2];
+} IterHeader;
+
+// --- Codes ---
+static unsigned long long muCode(float mu, int fracBits){
+    if(mu<0.0f) return mu>-1.5f ? 0 : 1;
+    return (unsigned long long)((double)mu*(double)(1ull<<fracBits))+ITER_CODE_BASE;
+}
+
+static float codeMu(unsigned long long c, int fracBits){
+    if(c<ITER_CODE_BASE) return -(float)(c+1);
+    c-=ITER_CODE_BASE;
+    return (float)((double)(c>>fracBits)+((double)(c&((1ull<<fracBits)-1))+0.5)/(double)(1ull<<fracBits));
+}
+
+static long long predict(const unsigned long long* row, const unsigned long long* above, int x, int y){
+    if(y==0) return x ? (long long)row[x-1] : 0;
+    if(x==0) return (long long)above[0];
+    long long a=(long long)row[x-1], b=(long long)above[x], c=(long long)above[x-1];
+    long long mx=a>b ? a : b, mn=a<b ? a : b;
+    return c>=mx ? mn : c<=mn ? mx : a+b-c;
+}
+
+// --- Adaptive Rice coding ---
+typedef struct { unsigned long long a; int n; } Rice;
+
+static void riceInit(Rice* r){ r->a=16; r->n=1; }
+static int riceK(const Rice* r){
+    int k=0;
+    while(((unsigned long long)r->n<<k)<r->a && k<56) k++;
+    return k;
+}
+static void riceUpdate(Rice* r, unsigned long long u){
+    r->a+=u<(1ull<<48) ? u : (1ull<<48);
+    if(++r->n==64){ r->a>>=1; r->n>>=1; }
+}
+
+typedef struct {
+    unsigned char* buf;
+    size_t size, cap;
+    unsigned long long acc;
+    int bits;
+} BitWriter;
+
+static void putBits(BitWriter* w, unsigned long long v, int n){    // n <= 57
+    w->acc|=v<<w->bits;
+    w->bits+=n;
+    while(w->bits>=8){
+        if(w->size==w->cap){ w->cap=w->cap ? w->cap*2 : 4096; w->buf=(unsigned char*)realloc(w->buf,w->cap); }
+        w->buf[w->size++]=(unsigned char)w->acc;
+        w->acc>>=8; w->bits-=8;
+    }
+}
+
+static void putRice(BitWriter* w, unsigned long long u, int k){
+    unsigned long long q=u>>k;
+    if(q<RICE_LIMIT){
+        putBits(w,((1ull<<q)-1),(int)q+1);      // q ones and a zero
+        putBits(w,u&((1ull<<k)-1),k);
+    } else {
+        int len=64-__builtin_clzll(u);
+        putBits(w,(1ull<<RICE_LIMIT)-1,RICE_LIMIT);
+        putBits(w,(unsigned long long)(len-1),6);
+        putBits(w,u&0xFFFFFFFFull,len<32 ? len : 32);
+        if(len>32) putBits(w,u>>32,len-32);
+    }
+}
+
+typedef struct {
+    const unsigned char *p, *end;
+    unsigned long long acc;
+    int bits;
+    size_t past;                // zero bytes fed beyond the end
+} BitReader;
+
+static void refill(BitReader* r){
+    while(r->bits<=56){
+        unsigned long long b=0;
+        if(r->p<r->end) b=*r->p++;
+        else r->past++;
+        r->acc|=b<<r->bits;
+        r->bits+=8;
+    }
+}
+
+static unsigned long long getBits(BitReader* r, int n){
+    if(n==0) return 0;
+    if(r->bits<n) refill(r);
+    unsigned long long v=r->acc&((1ull<<n)-1);
+    r->acc>>=n; r->bits-=n;
+    return v;
+}
+
+static unsigned long long getRice(BitReader* r, int k){
+    refill(r);
+    int q=__builtin_ctzll(~r->acc);
+    if(q<RICE_LIMIT){
+        r->acc>>=q+1; r->bits-=q+1;
+        return ((unsigned long long)q<<k)|getBits(r,k);
+    }
+    r->acc>>=RICE_LIMIT; r->bits-=RICE_LIMIT;
+    int len=(int)getBits(r,6)+1;
+    unsigned long long u=getBits(r,len<32 ? len : 32);
+    if(len>32) u|=getBits(r,len-32)<<32;
+    return u;
+}
+
+// --- Tiles ---
+static void encodeTile(const float* mu, int stride, int tw, int th, int fracBits, BitWriter* w){
+    unsigned long long rows[2][ITER_TILE];
+    Rice rice; riceInit(&rice);
+    for(int y=0;y<th;y++){
+        unsigned long long* row=rows[y&1];
+        const unsigned long long* above=rows[(y+1)&1];
+        for(int x=0;x<tw;x++){
+            row[x]=muCode(mu[(size_t)y*stride+x],fracBits);
+            long long r=(long long)row[x]-predict(row,above,x,y);
+            unsigned long long u=((unsigned long long)r<<1)^(unsigned long long)(r>>63);
+            putRice(w,u,riceK(&rice));
+            riceUpdate(&rice,u);
+        }
+    }
+    if(w->bits) putBits(w,0,8-w->bits);
+}
+
+static int decodeTile(const unsigned char* data, size_t size, int tw, int th, int fracBits, float* mu, int stride){
+    unsigned long long rows[2][ITER_TILE];
+    BitReader r={data,data+size,0,0,0};
+    Rice rice; riceInit(&rice);
+    for(int y=0;y<th;y++){
+        unsigned long long* row=rows[y&1];
+        const unsigned long long* above=rows[(y+1)&1];
+        for(int x=0;x<tw;x++){
+            unsigned long long u=getRice(&r,riceK(&rice));
+            riceUpdate(&rice,u);
+            long long d=(long long)(u>>1)^-(long long)(u&1);
+            row[x]=(unsigned long long)(predict(row,above,x,y)+d);
+            mu[(size_t)y*stride+x]=codeMu(row[x],fracBits);
+        }
+    }
+    // every bit read came from the tile
+    return r.past*8<=(size_t)r.bits;
+}
+
+// --- Writing ---
+int iterWriterOpen(IterWriter* w, const char* path, int width, int height, int fracBits){
+    memset(w,0,sizeof(*w));
+    if(width<1 || height<1 || fracBits<0 || fracBits>24) return 0;
+    w->f=fopen(path,"wb");
+    if(!w->f) return 0;
+    w->width=width; w->height=height; w->fracBits=fracBits;
+    w->tilesX=(width+ITER_TILE-1)/ITER_TILE;
+    w->tilesY=(height+ITER_TILE-1)/ITER_TILE;
+    w->lo=1e30f; w->hi=-1e30f;
+    size_t tiles=(size_t)w->tilesX*w->tilesY;
+    w->offsets=(unsigned long long*)calloc(tiles+1,sizeof(unsigned long long));
+    w->payload=(unsigned char**)calloc(w->tilesX,sizeof(unsigned char*));
+    w->payloadSize=(size_t*)calloc(w->tilesX,sizeof(size_t));
+    // header and offsets are rewritten on close
+    IterHeader h={{0}};
+    fwrite(&h,sizeof(h),1,w->f);
+    fwrite(w->offsets,sizeof(unsigned long long),tiles+1,w->f);
+    w->offsets[0]=sizeof(h)+(tiles+1)*sizeof(unsigned long long);
+    return 1;
+}
+
+typedef struct {
+    IterWriter* w;
+    const float* mu;
+    int th;
+    volatile int next;
+} RowJob;
+
+static void encodeWorker(void* ctx, int worker){
+    RowJob* j=(RowJob*)ctx;
+    IterWriter* w=j->w;
+    BitWriter bw={0};
+    (void)worker;
+    for(int tx; (tx=atomicFetchAdd(&j->next,1))<w->tilesX; ){
+        int x0=tx*ITER_TILE, tw=w->width-x0<ITER_TILE ? w->width-x0 : ITER_TILE;
+        bw.size=0; bw.acc=0; bw.bits=0;
+        encodeTile(j->mu+x0,w->width,tw,j->th,w->fracBits,&bw);
+        w->payload[tx]=(unsigned char*)malloc(bw.size ? bw.size : 1);
+        memcpy(w->payload[tx],bw.buf,bw.size);
+        w->payloadSize[tx]=bw.size;
+    }
+    free(bw.buf);
+}
+
+int iterWriterRow(IterWriter* w, const float* mu){
+    if(w->row>=w->tilesY) return 0;
+    int th=w->height-w->row*ITER_TILE;
+    if(th>ITER_TILE) th=ITER_TILE;
+    size_t n=(size_t)th*w->width;
+    for(size_t i=0;i<n;i++) if(mu[i]>=0.0f){ if(mu[i]<w->lo) w->lo=mu[i]; if(mu[i]>w->hi) w->hi=mu[i]; }
+
+    RowJob j={w,mu,th,0};
+    int workers=cpuCount(); if(workers>w->tilesX) workers=w->tilesX;
+    runWorkers(workers,encodeWorker,&j);
+
+    int ok=1;
+    for(int tx=0;tx<w->tilesX;tx++){
+        size_t t=(size_t)w->row*w->tilesX+tx;
+        ok&=fwrite(w->payload[tx],1,w->payloadSize[tx],w->f)==w->payloadSize[tx];
+        w->offsets[t+1]=w->offsets[t]+w->payloadSize[tx];
+        free(w->payload[tx]);
+    }
+    w->row++;
+    return ok;
+}
+
+int iterWriterClose(IterWriter* w){
+    int ok=w->f && w->row==w->tilesY;
+    if(w->f){
+        IterHeader h={{0}};
+        memcpy(h.magic,ITER_MAGIC,8);
+        h.width=w->width; h.height=w->height; h.tile=ITER_TILE; h.fracBits=w->fracBits;
+        h.lo=w->lo; h.hi=w->hi;
+        size_t tiles=(size_t)w->tilesX*w->tilesY;
+        ok&=fseek(w->f,0,SEEK_SET)==0
+            && fwrite(&h,sizeof(h),1,w->f)==1
+            && fwrite(w->offsets,sizeof(unsigned long long),tiles+1,w->f)==tiles+1;
+        ok&=fclose(w->f)==0;
+    }
+    free(w->offsets); free(w->payload); free(w->payloadSize);
+    memset(w,0,sizeof(*w));
+    return ok;
+}
+
+int iterWrite(const char* path, const float* mu, int width, int height, int fracBits){
+    IterWriter w;
+    if(!iterWriterOpen(&w,path,width,height,fracBits)) return 0;
+    int ok=1;
+    for(int ty=0;ty<w.tilesY;ty++) ok&=iterWriterRow(&w,mu+(size_t)ty*ITER_TILE*width);
+    return iterWriterClose(&w) && ok;
+}
+
+// --- Reading ---
+int iterFileOpen(IterFile* f, const char* path){
+    memset(f,0,sizeof(*f));
+#ifdef _WIN32
+    HANDLE file=CreateFileA(path,GENERIC_READ,FILE_SHARE_READ,NULL,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,NULL);
+    if(file==INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    HANDLE map=NULL;
+    if(GetFileSizeEx(file,&size) && size.QuadPart>0) map=CreateFileMappingA(file,NULL,PAGE_READONLY,0,0,NULL);
+    f->data = map ? (const unsigned char*)MapViewOfFile(map,FILE_MAP_READ,0,0,0) : NULL;
+    if(!f->data){ if(map) CloseHandle(map); CloseHandle(file); return 0; }
+    f->size=(size_t)size.QuadPart;
+    f->file=file; f->mapping=map;
+#else
+    int fd=open(path,O_RDONLY);
+    if(fd<0) return 0;
+    struct stat st;
+    void* data = fstat(fd,&st)==0 && st.st_size>0 ? mmap(NULL,(size_t)st.st_size,PROT_READ,MAP_PRIVATE,fd,0) : MAP_FAILED;
+    close(fd);
+    if(data==MAP_FAILED) return 0;
+    f->data=(const unsigned char*)data;
+    f->size=(size_t)st.st_size;
+#endif
+
+    const IterHeader* h=(const IterHeader*)f->data;
+    int ok=f->size>=sizeof(IterHeader) && memcmp(h->magic,ITER_MAGIC,8)==0 && h->tile==ITER_TILE
+        && h->width>0 && h->height>0 && h->fracBits<=24;
+    if(ok){
+        f->width=(int)h->width; f->height=(int)h->height; f->fracBits=(int)h->fracBits;
+        f->lo=h->lo; f->hi=h->hi;
+        f->tilesX=(f->width+ITER_TILE-1)/ITER_TILE;
+        f->tilesY=(f->height+ITER_TILE-1)/ITER_TILE;
+        size_t tiles=(size_t)f->tilesX*f->tilesY;
+        size_t table=sizeof(IterHeader)+(tiles+1)*sizeof(unsigned long long);
+        ok=f->size>=table;
+        if(ok){
+            f->offsets=(const unsigned long long*)(f->data+sizeof(IterHeader));
+            ok=f->offsets[0]==table && f->offsets[tiles]<=f->size;
+            for(size_t t=0;ok && t<tiles;t++) ok=f->offsets[t]<=f->offsets[t+1];
+        }
+    }
+    if(!ok) iterFileClose(f);
+    return ok;
+}
+
+void iterFileClose(IterFile* f){
+#ifdef _WIN32
+    if(f->data) UnmapViewOfFile(f->data);
+    if(f->mapping) CloseHandle((HANDLE)f->mapping);
+    if(f->file) CloseHandle((HANDLE)f->file);
+#else
+    if(f->data) munmap((void*)f->data,f->size);
+#endif
+    memset(f,0,sizeof(*f));
+}
+
+int iterFileTile(const IterFile* f, int tx, int ty, float* mu, int stride){
+    if(tx<0 || ty<0 || tx>=f->tilesX || ty>=f->tilesY) return 0;
+    size_t t=(size_t)ty*f->tilesX+tx;
+    int tw=f->width-tx*ITER_TILE, th=f->height-ty*ITER_TILE;
+    if(tw>ITER_TILE) tw=ITER_TILE;
+    if(th>ITER_TILE) th=ITER_TILE;
+    return decodeTile(f->data+f->offsets[t],(size_t)(f->offsets[t+1]-f->offsets[t]),tw,th,f->fracBits,mu,stride);
+}
+
+// --- Recolor mode ---
+typedef struct {
+    const IterFile* f;
+    unsigned char* rgb;
+    volatile int next;
+    volatile int bad;
+} RecolorJob;
+
+static void recolorWorker(void* ctx, int worker){
+    RecolorJob* j=(RecolorJob*)ctx;
+    const IterFile* f=j->f;
+    float mu[ITER_TILE*ITER_TILE];
+    float inv = f->hi>f->lo ? 1.0f/(f->hi-f->lo) : 1.0f;
+    (void)worker;
+    for(int t; (t=atomicFetchAdd(&j->next,1))<f->tilesX*f->tilesY; ){
+        int tx=t%f->tilesX, ty=t/f->tilesX;
+        if(!iterFileTile(f,tx,ty,mu,ITER_TILE)){ atomicFetchAdd(&j->bad,1); continue; }
+        for(int y=0;y<ITER_TILE && ty*ITER_TILE+y<f->height;y++)
+            for(int x=0;x<ITER_TILE && tx*ITER_TILE+x<f->width;x++){
+                float m=mu[y*ITER_TILE+x];
+                unsigned char* p=j->rgb+((size_t)(ty*ITER_TILE+y)*f->width+tx*ITER_TILE+x)*3;
+                if(m<0.0f) p[0]=p[1]=p[2]=0;
+                else paletteRGB((m-f->lo)*inv,p);
+            }
+    }
+}
+
+int recolorMain(int argc, char** argv){
+    if(argc<2){
+        printf("usage: fractal.exe recolor <in.fit> <out.png>\n");
+        return 1;
+    }
+    IterFile f;
+    if(!iterFileOpen(&f,argv[0])){
+        fprintf(stderr,"recolor: cannot read %s\n",argv[0]);
+        return 1;
+    }
+    double t0=nowSeconds();
+    unsigned char* rgb=(unsigned char*)malloc((size_t)f.width*f.height*3);
+    RecolorJob j={&f,rgb,0,0};
+    runWorkers(cpuCount(),recolorWorker,&j);
+    printf("%dx%d, %.2f bits per pixel, decoded in %.3fs",f.width,f.height,f.size*8.0/((double)f.width*f.height),nowSeconds()-t0);
+    if(j.bad) printf(", %d corrupt tiles",j.bad);
+    printf("\n");
+    int ok=writePNG(argv[1],rgb,f.width,f.height);
+    if(!ok) fprintf(stderr,"recolor: cannot write %s\n",argv[1]);
+    free(rgb);
+    iterFileClose(&f);
+    return ok && !j.bad ? 0 : 1;
+}
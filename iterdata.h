@@ -0,0 +1,55 @@
+// Compact iteration data: smooth iteration counts stored for recoloring
+//
+// Each pixel is one code: the integer iteration count followed by fracBits
+// bits of its smooth fraction, or a small code for bounded (mu = -1) and other
+// negative markers. Codes are predicted from their neighbours inside fixed
+// tiles and the residuals Rice coded with an adaptive parameter, so smooth
+// regions take a few bits per pixel and noisy ones only what they need.
+//
+// A file is a header, a table of tile offsets and the tiles; tiles decode
+// independently, so a file can be mapped and read a tile at a time.
+#ifndef ITERDATA_H
+#define ITERDATA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define ITER_TILE 64
+#define ITER_FRAC_BITS 10       // default fraction precision, 1/1024 iteration
+
+// --- Writing, one row of tiles at a time ---
+typedef struct {
+    FILE* f;
+    int width, height, fracBits, tilesX, tilesY;
+    int row;                        // tile rows written
+    float lo, hi;                   // range of non-negative mu so far
+    unsigned long long* offsets;    // tilesX*tilesY+1 file offsets
+    unsigned char** payload;        // per-tile scratch for the current row
+    size_t* payloadSize;
+} IterWriter;
+
+int iterWriterOpen(IterWriter* w, const char* path, int width, int height, int fracBits);
+// mu holds ITER_TILE rows (fewer for the last row of tiles) of width floats
+int iterWriterRow(IterWriter* w, const float* mu);
+// Writes the offset table and range; returns 0 on any write error
+int iterWriterClose(IterWriter* w);
+// Whole image in one call
+int iterWrite(const char* path, const float* mu, int width, int height, int fracBits);
+
+// --- Reading from a mapped file ---
+typedef struct {
+    int width, height, fracBits, tilesX, tilesY;
+    float lo, hi;
+    const unsigned char* data;
+    size_t size;
+    const unsigned long long* offsets;
+    void* mapping;                  // platform handles
+    void* file;
+} IterFile;
+
+int iterFileOpen(IterFile* f, const char* path);
+void iterFileClose(IterFile* f);
+// Decodes tile (tx, ty) into mu with rows stride floats apart; returns 0 if corrupt
+int iterFileTile(const IterFile* f, int tx, int ty, float* mu, int stride);
+
+#endif
@@ -0,0 +1,142 @@
+// Native code for formula programs: emitKernelC() output built by the local C
+// compiler into a shared library and loaded at runtime
+//
+// Libraries are cached on disk under jitcache/ by a hash of the ops, the
+// compiler command, the include directory and the headers in it, and
+// JIT_VERSION, so a formula is compiled once per machine and later runs only
+// pay for loading it. The headers are found through FRACTAL_JIT_INCLUDE, else
+// next to the executable, where the build scripts leave it beside the sources.
+// Loaded kernels stay resident for the life of the process.
+#include "formula.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define JIT_EXT ".dll"
+#define JIT_PIC ""
+#define JIT_SEP "\\"
+#else
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define JIT_EXT ".so"
+#define JIT_PIC " -fPIC"
+#define JIT_SEP "/"
+#endif
+
+#define JIT_VERSION 1       // bump when emitKernelC() or KernelParams change
+#define JIT_DIR "jitcache"
+#define JIT_SYMBOL "formula_kernel"
+#define JIT_LOADED 32
+
+static const char* jitHeaders[]={"kernel.h","escape.h","simd.h"};     // what emitKernelC() output includes
+static struct { unsigned long long hash; KernelFn fn; } loaded[JIT_LOADED];
+static int loadedCount;
+
+static unsigned long long fnv1a(unsigned long long h, const void* data, size_t n){
+    const unsigned char* p=(const unsigned char*)data;
+    for(size_t i=0;i<n;i++){ h^=p[i]; h*=0x100000001B3ull; }
+    return h;
+}
+
+static const char* jitCompiler(void){
+    const char* cc=getenv("FRACTAL_JIT_CC");
+    return cc && *cc ? cc : "gcc -O2 -march=native -ffp-contract=off -Wno-psabi";
+}
+
+static const char* jitInclude(void){
+    static char dir[1024];
+    const char* inc=getenv("FRACTAL_JIT_INCLUDE");
+    if(inc && *inc) return inc;
+    if(dir[0]) return dir;
+#ifdef _WIN32
+    DWORD n=GetModuleFileNameA(NULL,dir,sizeof(dir));
+    if(n>=sizeof(dir)) n=0;
+#else
+    ssize_t n=readlink("/proc/self/exe",dir,sizeof(dir)-1);
+    if(n<0) n=0;
+#endif
+    dir[n]='\0';
+    char* slash=strrchr(dir,JIT_SEP[0]);
+    if(!slash){ strcpy(dir,"."); return dir; }
+    *(slash==dir ? slash+1 : slash)='\0';
+    return dir;
+}
+
+// Folds a header's contents into h so editing kernel.h invalidates the cache;
+// a missing header hashes as empty and the compiler reports it
+static unsigned long long hashHeader(unsigned long long h, const char* name){
+    char path[1200], buf[4096];
+    snprintf(path,sizeof(path),"%s" JIT_SEP "%s",jitInclude(),name);
+    FILE* f=fopen(path,"rb");
+    if(!f) return h;
+    size_t n;
+    while((n=fread(buf,1,sizeof(buf),f))>0) h=fnv1a(h,buf,n);
+    fclose(f);
+    return h;
+}
+
+static unsigned long long programHash(const FormulaProgram* prog){
+    unsigned long long h=0xCBF29CE484222325ull;
+    int version=JIT_VERSION;
+    h=fnv1a(h,&version,sizeof(version));
+    h=fnv1a(h,jitCompiler(),strlen(jitCompiler()));
+    h=fnv1a(h,jitInclude(),strlen(jitInclude()));
+    for(size_t k=0;k<sizeof(jitHeaders)/sizeof(jitHeaders[0]);k++) h=hashHeader(h,jitHeaders[k]);
+    h=fnv1a(h,&prog->result,sizeof(prog->result));
+    for(int k=0;k<prog->count;k++){
+        const Op* o=&prog->ops[k];
+        int fields[4]={o->op,o->a,o->b,o->n};
+        h=fnv1a(h,fields,sizeof(fields));
+        if(o->op==OP_CONST){ h=fnv1a(h,&o->re,sizeof(o->re)); h=fnv1a(h,&o->im,sizeof(o->im)); }
+    }
+    return h;
+}
+
+static KernelFn loadKernel(const char* path){
+#ifdef _WIN32
+    HMODULE lib=LoadLibraryA(path);
+    return lib ? (KernelFn)GetProcAddress(lib,JIT_SYMBOL) : NULL;
+#else
+    void* lib=dlopen(path,RTLD_NOW|RTLD_LOCAL);
+    return lib ? (KernelFn)dlsym(lib,JIT_SYMBOL) : NULL;
+#endif
+}
+
+KernelFn jitFormulaKernel(const FormulaProgram* prog, int* cached, char* err, int errSize){
+    unsigned long long hash=programHash(prog);
+    if(cached) *cached=1;
+    for(int k=0;k<loadedCount;k++) if(loaded[k].hash==hash) return loaded[k].fn;
+
+    char base[64], lib[96], src[96], tmp[96];
+    snprintf(base,sizeof(base),JIT_DIR JIT_SEP "f_%016llx",hash);
+    snprintf(lib,sizeof(lib),"%s" JIT_EXT,base);
+    KernelFn fn=loadKernel(lib);
+
+    if(!fn){
+        if(cached) *cached=0;
+#ifdef _WIN32
+        CreateDirectoryA(JIT_DIR,NULL);
+#else
+        mkdir(JIT_DIR,0777);
+#endif
+        snprintf(src,sizeof(src),"%s.c",base);
+        snprintf(tmp,sizeof(tmp),"%s.tmp",base);
+        FILE* f=fopen(src,"w");
+        if(!f){ snprintf(err,errSize,"cannot write %s",src); return NULL; }
+        emitKernelC(prog,JIT_SYMBOL,f);
+        fclose(f);
+
+        // build under a temporary name so a concurrent process never loads a partial file
+        char cmd[1024];
+        snprintf(cmd,sizeof(cmd),"%s%s -shared -I\"%s\" -o \"%s\" \"%s\"",jitCompiler(),JIT_PIC,jitInclude(),tmp,src);
+        if(system(cmd)!=0){ snprintf(err,errSize,"compiler failed: %s",cmd); remove(tmp); return NULL; }
+        if(rename(tmp,lib)!=0) remove(tmp);     // lost a race; the winner's library is identical
+        fn=loadKernel(lib);
+        if(!fn){ snprintf(err,errSize,"cannot load %s",lib); return NULL; }
+    }
+
+    if(loadedCount<JIT_LOADED){ loaded[loadedCount].hash=hash; loaded[loadedCount].fn=fn; loadedCount++; }
+    return fn;
+}
@@ -1,29 +1,59 @@
 #version 330 core
-uniform vec2 u_center; // re-used to pass the c parameter if you want
-uniform float u_scale;
-uniform int u_maxIter;
+layout(std140) uniform Params {     // ShaderParams in fractal.h
+    vec2 u_center;
+    float u_scale;
+    int u_maxIter;
+    vec2 u_param;       // formula parameter, e.g. the Julia c
+    int u_paramSet;     // 0: keep the shader's own
+    int u_deMode;       // 1: shade by exterior distance estimate
+    int u_histogram;    // 1: palette by the frame's escape-time distribution
+};
 in vec2 uv;
 out vec4 FragColor;
+layout(location=1) out float Mu;    // escape time for histogram coloring, -1 inside
+uniform sampler2D u_cdf;
+
+float palettePos(float mu){
+    if(u_histogram == 0) return mu/float(u_maxIter);
+    return texture(u_cdf, vec2(log(1.0 + max(mu, 0.0))/log(1.0 + float(u_maxIter)), 0.5)).r;
+}
 
 vec3 palette(float t){ return vec3(0.5+0.5*cos(6.28318*(t+vec3(0,0.33,0.67)))); }
 
+#ifdef INSTANCE_PARAM
+flat in vec3 v_param;               // per instance: c, set (explorer.c, atlas.c)
+vec2 juliaParam(vec2 c){ return v_param.z != 0.0 ? v_param.xy : c; }
+#else
+vec2 juliaParam(vec2 c){ return u_paramSet != 0 ? u_param : c; }
+#endif
+
 void main(){
-    // Use u_center as both center and also (optionally) the Julia parameter:
-    vec2 c = vec2(-0.8, 0.156); // default Julia param; change or map to UI
-    // if you want to use u_center as c: c = u_center;
+    Mu = -1.0;
+    vec2 c = juliaParam(vec2(-0.8, 0.156));
     vec2 z = (uv - vec2(0.5))*u_scale*2.0 + u_center;
+    float px = length(fwidth(z));
+    float bailout = u_deMode != 0 ? 1e6 : 4.0;
+    vec2 dz = vec2(1.0, 0.0);  // dz/dz0
     int i;
     for(i=0;i<u_maxIter;i++){
+        // dz = 2*z*dz
+        dz = 2.0*vec2(z.x*dz.x - z.y*dz.y, z.x*dz.y + z.y*dz.x);
         // z = z^2 + c
         vec2 nz = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
         z = nz;
-        if(dot(z,z) > 4.0) break;
+        if(dot(z,z) > bailout) break;
     }
     float it = float(i);
     if(i == u_maxIter) FragColor = vec4(0.0);
     else {
         float mu = it + 1.0 - log(log(length(z)))/log(2.0);
-        FragColor = vec4(palette(mu/float(u_maxIter)),1.0);
+        Mu = mu;
+        vec3 col = palette(palettePos(mu));
+        if(u_deMode != 0){
+            float de = 0.5*length(z)*log(length(z))/length(dz);
+            col *= clamp(sqrt(de/(2.0*px)), 0.0, 1.0);
+        }
+        FragColor = vec4(col,1.0);
     }
 }
 
@@ -0,0 +1,59 @@
+// Multithreaded driver for packet kernels, shared by every CPU formula path
+#include "kernel.h"
+#include "threads.h"
+#include <math.h>
+#include <stdlib.h>
+
+typedef struct {
+    KernelFn fn;
+    const KernelParams* params;
+    const View* view;
+    double x0, y0, pixel, logPower;
+    unsigned char* rgb;
+    volatile int nextRow;
+} KernelJob;
+
+void paletteRGB(double t, unsigned char* rgb){
+    static const double phase[3]={0.0,0.33,0.67};
+    for(int k=0;k<3;k++){
+        double v=0.5+0.5*cos(6.28318*(t+phase[k]));
+        rgb[k]=(unsigned char)(v*255.0+0.5);
+    }
+}
+
+static void kernelWorker(void* ctx, int worker){
+    KernelJob* j=(KernelJob*)ctx;
+    const View* v=j->view;
+    double x[SIMD_WD], y[SIMD_WD], r2[SIMD_WD];
+    int iter[SIMD_WD];
+    for(;;){
+        int row=atomicFetchAdd(&j->nextRow,1);
+        if(row>=v->height) return;
+        unsigned char* out=j->rgb+(size_t)row*v->width*3;
+        for(int px=0;px<v->width;px+=SIMD_WD){
+            for(int k=0;k<SIMD_WD;k++){
+                x[k]=j->x0+(px+k+0.5)*j->pixel;
+                y[k]=j->y0-(row+0.5)*j->pixel;
+            }
+            j->fn(j->params,x,y,iter,r2);
+            for(int k=0;k<SIMD_WD && px+k<v->width;k++){
+                unsigned char* o=out+(px+k)*3;
+                if(iter[k]>=j->params->maxIter){ o[0]=o[1]=o[2]=0; continue; }
+                double mu=iter[k]+1.0-log(0.5*log(r2[k]))/j->logPower;
+                paletteRGB(mu/j->params->maxIter,o);
+            }
+        }
+    }
+}
+
+double renderKernel(KernelFn fn, const KernelParams* p, const View* v, double power, unsigned char* rgb){
+    KernelJob j={0};
+    j.fn=fn; j.params=p; j.view=v; j.rgb=rgb;
+    j.pixel=2.0*v->scale/v->height;
+    j.x0=v->cx-j.pixel*v->width*0.5;
+    j.y0=v->cy+v->scale;
+    j.logPower=log(power);
+    double t0=nowSeconds();
+    runWorkers(cpuCount(),kernelWorker,&j);
+    return nowSeconds()-t0;
+}
@@ -0,0 +1,40 @@
+// Packet escape-time kernels: the contract shared by generated and built-in formulas
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include "escape.h"
+#include "simd.h"
+
+typedef struct {
+    int julia;          // z0 = pixel and c = (jr,ji) instead of z0 = 0, c = pixel
+    double jr, ji;
+    int maxIter;
+    double bailout;     // squared escape radius
+    const void* user;   // kernel specific data, e.g. an interpreted program
+} KernelParams;
+
+// Iterates SIMD_WD points at once. iter receives the escape iteration (maxIter when
+// bounded) and r2 the final |z|^2, which is all the smooth coloring needs.
+typedef void (*KernelFn)(const KernelParams* p, const double* x, const double* y, int* iter, double* r2);
+
+// mandelbrot.frag's palette, t in [0,1]
+void paletteRGB(double t, unsigned char* rgb);
+
+// Renders the view with all cores into rgb (top row first), coloring by the smooth
+// iteration count for a formula of the given degree. Returns the elapsed seconds.
+double renderKernel(KernelFn fn, const KernelParams* p, const View* v, double power, unsigned char* rgb);
+
+// --- Built-in kernels (specialized.c) ---
+typedef struct {
+    const char* name;   // shader name without .frag
+    KernelFn fn;
+    double power;
+    int julia;
+    double jr, ji;
+} BuiltinKernel;
+
+// Accepts "tricorn" or "tricorn.frag"; NULL when there is no CPU kernel
+const BuiltinKernel* findBuiltinKernel(const char* name);
+void builtinKernelParams(const BuiltinKernel* b, int maxIter, KernelParams* p);
+
+#endif
@@ -1,29 +1,54 @@
 #version 330 core
-uniform vec2 u_center;
-uniform float u_scale;
-uniform int u_maxIter;
+layout(std140) uniform Params {     // ShaderParams in fractal.h
+    vec2 u_center;
+    float u_scale;
+    int u_maxIter;
+    vec2 u_param;       // formula parameter, e.g. the Julia c
+    int u_paramSet;     // 0: keep the shader's own
+    int u_deMode;       // 1: shade by exterior distance estimate
+    int u_histogram;    // 1: palette by the frame's escape-time distribution
+};
 in vec2 uv;
 out vec4 FragColor;
+layout(location=1) out float Mu;    // escape time for histogram coloring, -1 inside
+uniform sampler2D u_cdf;
+
+float palettePos(float mu){
+    if(u_histogram == 0) return mu/float(u_maxIter);
+    return texture(u_cdf, vec2(log(1.0 + max(mu, 0.0))/log(1.0 + float(u_maxIter)), 0.5)).r;
+}
 
 vec3 palette(float t){
     return vec3(0.5 + 0.5*cos(6.28318*(t+vec3(0.0,0.33,0.67))));
 }
 
 void main(){
+    Mu = -1.0;
     vec2 c = (uv - vec2(0.5))*u_scale*2.0 + u_center;
+    float px = length(fwidth(c));   // pixel size in the plane
+    float bailout = u_deMode != 0 ? 1e6 : 4.0;
     vec2 z = vec2(0.0);
+    vec2 dz = vec2(0.0);            // dz/dc
     int i;
     for(i=0;i<u_maxIter;i++){
+        // dz = 2*z*dz + 1
+        dz = 2.0*vec2(z.x*dz.x - z.y*dz.y, z.x*dz.y + z.y*dz.x) + vec2(1.0, 0.0);
         // z = z^2 + c
         vec2 zz = vec2(z.x*z.x - z.y*z.y, 2.0*z.x*z.y) + c;
         z = zz;
-        if(dot(z,z) > 4.0) break;
+        if(dot(z,z) > bailout) break;
     }
     float iter = float(i);
     if(i < u_maxIter){
         // smooth iteration count
         float mu = iter + 1.0 - log(log(length(z)))/log(2.0);
-        FragColor = vec4(palette(mu / float(u_maxIter)), 1.0);
+        Mu = mu;
+        vec3 col = palette(palettePos(mu));
+        if(u_deMode != 0){
+            float de = 0.5*length(z)*log(length(z))/length(dz);
+            col *= clamp(sqrt(de/(2.0*px)), 0.0, 1.0);
+        }
+        FragColor = vec4(col, 1.0);
     } else {
         FragColor = vec4(0.0,0.0,0.0,1.0);
     }
@@ -1,7 +1,18 @@
 #version 330 core
-uniform vec2 u_center;   // can be reused for camera control (optional)
-uniform float u_scale;   // zoom-like (distance scaling)
-uniform int u_maxIter;   // used as raymarch steps
+layout(std140) uniform Params {     // ShaderParams in fractal.h
+    vec2 u_center;
+    float u_scale;
+    int u_maxIter;
+    vec2 u_param;       // formula parameter, e.g. the Julia c
+    int u_paramSet;     // 0: keep the shader's own
+    int u_deMode;       // 1: shade by exterior distance estimate
+    int u_histogram;    // 1: palette by the frame's escape-time distribution
+};
+uniform int u_pass;      // 0: plain march, 1: cone prepass, 2: march from prepass depth
+uniform int u_coneBlock; // pixels per prepass texel (edge)
+uniform vec2 u_resolution;
+uniform float u_aspect;  // shared with the vertex shader, which widens uv by it
+uniform sampler2D u_startDepth;
 in vec2 uv;
 out vec4 FragColor;
 
@@ -9,7 +20,13 @@ out vec4 FragColor;
 vec3 cameraDir(vec2 uv, float zoom){
     // uv in [0,1] → [-1,1] range
     vec2 p = (uv - 0.5) * 2.0;
-    return normalize(vec3(p, zoom));
+    return normalize(vec3(p, -zoom));   // camera sits on +z looking at the origin
+}
+
+vec3 rayDir(vec2 uv){
+    vec3 rd = cameraDir(uv, 1.5);
+    rd.xy *= u_scale;                    // crude zoom with u_scale
+    return rd;
 }
 
 // --- SDF for Menger sponge ---
@@ -38,14 +55,41 @@ vec3 getNormal(vec3 p){
                       h.xxx*mengerSDF(p+h.xxx*eps) );
 }
 
+// --- cone prepass ---
+// Marches one cone enclosing every ray of this texel's pixel block. While the
+// SDF at the axis exceeds the cone radius no ray in the block can hit, so the
+// t where the cone first touches the surface is a safe start for all of them.
+float coneStart(vec3 ro){
+    vec2 block = vec2(float(u_coneBlock));
+    // the block's corners in the vertex shader's uv
+    vec2 stretch = vec2(u_aspect > 0.0 ? u_aspect : 1.0, 1.0);
+    vec2 uv0 = (floor(gl_FragCoord.xy) * block / u_resolution - 0.5) * stretch + 0.5;
+    vec2 uv1 = uv0 + block / u_resolution * stretch;
+    vec3 axis = rayDir((uv0 + uv1) * 0.5);
+    float spread = 0.0, maxLen = length(axis);
+    for(int i=0; i<4; i++){
+        vec3 k = rayDir(vec2(i==1||i==3 ? uv1.x : uv0.x, i>=2 ? uv1.y : uv0.y));
+        spread = max(spread, length(k - axis));
+        maxLen = max(maxLen, length(k));
+    }
+    float t = 0.0;
+    for(int i=0; i<u_maxIter; i++){
+        float clearance = mengerSDF(ro + axis*t) - spread*t;
+        if(clearance < 0.004 || t > 20.0) break;
+        t += clearance / maxLen;
+    }
+    return t;
+}
+
 // --- main raymarch loop ---
 void main(){
     // camera
     vec3 ro = vec3(0.0,0.0,4.0);         // ray origin
-    vec3 rd = cameraDir(uv, 1.5);        // ray dir
-    rd.xy *= u_scale;                    // crude zoom with u_scale
+    if(u_pass == 1){ FragColor = vec4(coneStart(ro)); return; }
+    vec3 rd = rayDir(uv);                // ray dir
 
     float t = 0.0;
+    if(u_pass == 2) t = texelFetch(u_startDepth, ivec2(gl_FragCoord.xy) / u_coneBlock, 0).r;
     float dist;
     bool hit = false;
     for(int i=0; i<u_maxIter; i++){
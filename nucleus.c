@@ -0,0 +1,245 @@
+// Minibrot nucleus finder for planning deep zooms
+//
+//   fractal.exe nucleus <re> <im> <radius> [maxPeriod]
+//
+// Prints the period, position and size of the nearest minibrot to the view
+// centred on (re, im) with half-height radius; the position and a radius of a
+// few times the size can be passed straight to the deep mode.
+//
+// The period comes from iterating the corners of the view, as perturbed
+// offsets from the centre's reference orbit, until the quadrilateral they
+// span winds around 0 (Munafo's box period): the lowest period with a nucleus
+// in view. When none turns up before maxPeriod, or a corner escapes first, the
+// centre's atom domain is used instead: the n minimizing |Z_n|, whose nucleus
+// may lie outside the view.
+//
+// Newton's method then solves z_p(c) = 0 from the centre, with z and dz/dc in
+// MPFR but each step taken in floatexp. z_p also vanishes at every nucleus of
+// a period dividing p, which plain Newton from afar tends to find instead, so
+// those roots are divided out: the step is 1 / (z_p'/z_p - sum z_k'/z_k) over
+// the proper divisors k. The atom size estimate
+//
+//   l_n = 2 z_n l_{n-1},  b_n = b_{n-1} + 1/l_n,  size = 1 / (b_{p-1} l_{p-1}^2)
+//
+// says how deep the minibrot is. Precision starts from the radius and is raised
+// and Newton resumed until it also resolves the minibrot.
+#include "fractal.h"
+#include "deep.h"
+#include "threads.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NEWTON_STEPS 64
+
+typedef struct { floatexp re, im; } fecomplex;
+
+static fecomplex fcMul(fecomplex a, fecomplex b){
+    fecomplex r={feSub(feMul(a.re,b.re),feMul(a.im,b.im)),feAdd(feMul(a.re,b.im),feMul(a.im,b.re))};
+    return r;
+}
+
+static fecomplex fcDiv(fecomplex a, fecomplex b){
+    floatexp d=feNorm2(b.re,b.im);
+    fecomplex r={feDiv(feAdd(feMul(a.re,b.re),feMul(a.im,b.im)),d),feDiv(feSub(feMul(a.im,b.re),feMul(a.re,b.im)),d)};
+    return r;
+}
+
+static void mpfrSubFe(mpfr_ptr x, floatexp d, mpfr_ptr tmp){
+    mpfr_set_d(tmp,d.m,MPFR_RNDN);
+    mpfr_mul_2si(tmp,tmp,d.e,MPFR_RNDN);
+    mpfr_sub(x,x,tmp,MPFR_RNDN);
+}
+
+static int feSign(floatexp a){ return (a.m>0.0)-(a.m<0.0); }
+
+// Winding number of the polygon v[0..n-1] around the origin
+static int winding(const fecomplex* v, int n){
+    int wn=0;
+    for(int i=0;i<n;i++){
+        fecomplex a=v[i], b=v[(i+1)%n];
+        int side=feSign(feSub(feMul(a.re,b.im),feMul(b.re,a.im)));   // origin left of a->b
+        if(feSign(a.im)<=0){ if(feSign(b.im)>0 && side>0) wn++; }
+        else if(feSign(b.im)<=0 && side<0) wn--;
+    }
+    return wn;
+}
+
+int nucleusPeriod(mpfr_srcptr cr, mpfr_srcptr ci, floatexp radius, int maxPeriod, int* inView){
+    RefOrbit o;
+    refOrbitInit(&o,mpfr_get_prec(cr));
+    mpfr_set(o.cr,cr,MPFR_RNDN); mpfr_set(o.ci,ci,MPFR_RNDN);
+    refOrbitCompute(&o,maxPeriod);
+
+    // corners of the square of half-side radius, as offsets from the reference
+    floatexp nr=feNeg(radius);
+    fecomplex dc[4]={{radius,radius},{nr,radius},{nr,nr},{radius,nr}};
+    fecomplex d[4], z[4];
+    memcpy(d,dc,sizeof(d));                 // z_1 = c
+    int period=0, atom=1;
+    double atomR2=INFINITY;
+    floatexp bailout=feFromDouble(DEEP_BAILOUT);
+    for(int n=1;n<o.length && !period;n++){
+        fecomplex Z={feFromDouble(o.zr[n]),feFromDouble(o.zi[n])};
+        int escaped=0;
+        for(int k=0;k<4;k++){
+            z[k].re=feAdd(Z.re,d[k].re); z[k].im=feAdd(Z.im,d[k].im);
+            escaped|=feLess(bailout,feNorm2(z[k].re,z[k].im));
+        }
+        if(escaped) break;
+        if(winding(z,4)){ period=n; break; }
+        double r2=o.zr[n]*o.zr[n]+o.zi[n]*o.zi[n];
+        if(r2<atomR2){ atomR2=r2; atom=n; }
+        // d' = (2Z + d) d + dc
+        for(int k=0;k<4;k++){
+            fecomplex t={feAdd(feLdexp(Z.re,1),d[k].re),feAdd(feLdexp(Z.im,1),d[k].im)};
+            t=fcMul(t,d[k]);
+            d[k].re=feAdd(t.re,dc[k].re); d[k].im=feAdd(t.im,dc[k].im);
+        }
+    }
+    refOrbitFree(&o);
+    *inView=period>0;
+    return period ? period : atom;
+}
+
+int nucleusNewton(mpfr_ptr cr, mpfr_ptr ci, int period, int maxSteps){
+    mpfr_prec_t prec=mpfr_get_prec(cr);
+    mpfr_t x, y, dx, dy, t, u;
+    mpfr_init2(x,prec); mpfr_init2(y,prec); mpfr_init2(dx,prec); mpfr_init2(dy,prec);
+    mpfr_init2(t,prec); mpfr_init2(u,prec);
+    int steps=0, converged=0;
+    while(steps<maxSteps && !converged){
+        mpfr_set_ui(x,0,MPFR_RNDN); mpfr_set_ui(y,0,MPFR_RNDN);
+        mpfr_set_ui(dx,0,MPFR_RNDN); mpfr_set_ui(dy,0,MPFR_RNDN);
+        fecomplex deflate={{0.0,FE_ZERO_EXP},{0.0,FE_ZERO_EXP}};
+        for(int n=0;n<period;n++){
+            if(n>0 && period%n==0){
+                fecomplex zk={feFromMpfr(x),feFromMpfr(y)}, dk={feFromMpfr(dx),feFromMpfr(dy)};
+                fecomplex q=fcDiv(dk,zk);
+                deflate.re=feAdd(deflate.re,q.re); deflate.im=feAdd(deflate.im,q.im);
+            }
+            // dz = 2 z dz + 1
+            mpfr_mul(t,x,dx,MPFR_RNDN); mpfr_mul(u,y,dy,MPFR_RNDN); mpfr_sub(t,t,u,MPFR_RNDN);
+            mpfr_mul(u,x,dy,MPFR_RNDN); mpfr_mul(dy,y,dx,MPFR_RNDN); mpfr_add(u,u,dy,MPFR_RNDN);
+            mpfr_mul_2ui(dx,t,1,MPFR_RNDN); mpfr_add_d(dx,dx,1.0,MPFR_RNDN);
+            mpfr_mul_2ui(dy,u,1,MPFR_RNDN);
+            // z = z^2 + c
+            mpfr_sqr(t,x,MPFR_RNDN); mpfr_sqr(u,y,MPFR_RNDN); mpfr_sub(t,t,u,MPFR_RNDN);
+            mpfr_mul(y,x,y,MPFR_RNDN); mpfr_mul_2ui(y,y,1,MPFR_RNDN); mpfr_add(y,y,ci,MPFR_RNDN);
+            mpfr_add(x,t,cr,MPFR_RNDN);
+        }
+        fecomplex z={feFromMpfr(x),feFromMpfr(y)}, dz={feFromMpfr(dx),feFromMpfr(dy)};
+        // an exact hit on the root
+        if(z.re.m==0.0 && z.im.m==0.0){ converged=1; break; }
+        if(dz.re.m==0.0 && dz.im.m==0.0) break;
+        // f = z_p / prod z_k over proper divisors k, so f'/f = dz/z - sum dz_k/z_k
+        fecomplex q=fcDiv(dz,z);
+        q.re=feSub(q.re,deflate.re); q.im=feSub(q.im,deflate.im);
+        floatexp one=feFromDouble(1.0), zero={0.0,FE_ZERO_EXP};
+        fecomplex step=fcDiv((fecomplex){one,zero},q);
+        mpfrSubFe(cr,step.re,t);
+        mpfrSubFe(ci,step.im,t);
+        steps++;
+        // steps below the last few bits of c no longer move it
+        floatexp size=feNorm2(step.re,step.im);
+        converged=size.m==0.0 || size.e<2*(8-(int)prec);
+    }
+    mpfr_clear(x); mpfr_clear(y); mpfr_clear(dx); mpfr_clear(dy);
+    mpfr_clear(t); mpfr_clear(u);
+    return converged ? steps : -steps;
+}
+
+floatexp nucleusSize(mpfr_srcptr cr, mpfr_srcptr ci, int period, double* angle){
+    RefOrbit o;
+    refOrbitInit(&o,mpfr_get_prec(cr));
+    mpfr_set(o.cr,cr,MPFR_RNDN); mpfr_set(o.ci,ci,MPFR_RNDN);
+    refOrbitCompute(&o,period);
+    floatexp one=feFromDouble(1.0), zero={0.0,FE_ZERO_EXP};
+    fecomplex l={one,zero}, b={one,zero};
+    for(int n=1;n<period && n<o.length;n++){
+        fecomplex z={feFromDouble(2*o.zr[n]),feFromDouble(2*o.zi[n])};
+        l=fcMul(z,l);
+        fecomplex inv=fcDiv((fecomplex){one,zero},l);
+        b.re=feAdd(b.re,inv.re); b.im=feAdd(b.im,inv.im);
+    }
+    refOrbitFree(&o);
+    fecomplex s=fcDiv((fecomplex){one,zero},fcMul(b,fcMul(l,l)));
+    // the angle needs only the ratio, which is safe in doubles after aligning exponents
+    int e=s.re.e>s.im.e ? s.re.e : s.im.e;
+    *angle=atan2(feToDouble(feLdexp(s.im,-e)),feToDouble(feLdexp(s.re,-e)));
+    floatexp n2=feNorm2(s.re,s.im);
+    return feNorm(sqrt(n2.m*((n2.e&1) ? 2.0 : 1.0)),(n2.e-(n2.e&1))/2);
+}
+
+static void printFe(floatexp v){
+    if(v.m==0.0){ printf("0"); return; }
+    double l=log10(fabs(v.m))+v.e*0.30102999566398120;
+    double e=floor(l);
+    printf("%.6fe%+.0f",v.m<0 ? -pow(10.0,l-e) : pow(10.0,l-e),e);
+}
+
+int nucleusMain(int argc, char** argv){
+    if(argc<3){
+        printf("usage: fractal.exe nucleus <re> <im> <radius> [maxPeriod]\n");
+        return 1;
+    }
+    int maxPeriod = argc>3 ? atoi(argv[3]) : 10000;
+    mpfr_t radius;
+    mpfr_init2(radius,64);
+    int ok=mpfr_set_str(radius,argv[2],10,MPFR_RNDN)==0 && mpfr_sgn(radius)>0 && maxPeriod>0;
+    floatexp r=feFromMpfr(radius);
+    mpfr_clear(radius);
+    mpfr_prec_t prec=deepPrecision(r,1024);
+    mpfr_t cr, ci, d;
+    mpfr_init2(cr,prec); mpfr_init2(ci,prec);
+    if(!ok || mpfr_set_str(cr,argv[0],10,MPFR_RNDN)!=0 || mpfr_set_str(ci,argv[1],10,MPFR_RNDN)!=0){
+        fprintf(stderr,"nucleus: bad arguments\n");
+        mpfr_clear(cr); mpfr_clear(ci);
+        return 1;
+    }
+
+    double t0=nowSeconds();
+    int inView;
+    int period=nucleusPeriod(cr,ci,r,maxPeriod,&inView);
+    printf("period %d (%s)\n",period,inView ? "nucleus in view" : "atom domain, nucleus may be outside the view");
+
+    // refine, then raise precision until it resolves the minibrot itself
+    mpfr_init2(d,prec);
+    mpfr_set(d,cr,MPFR_RNDN);
+    int steps=0, converged=0;
+    floatexp size;
+    double angle;
+    while(1){
+        int s=nucleusNewton(cr,ci,period,NEWTON_STEPS);
+        steps+=s<0 ? -s : s;
+        converged=s>0;
+        size=nucleusSize(cr,ci,period,&angle);
+        mpfr_prec_t need=deepPrecision(size,1024);
+        if(!converged || need<=prec) break;
+        prec=need;
+        mpfr_prec_round(cr,prec,MPFR_RNDN); mpfr_prec_round(ci,prec,MPFR_RNDN);
+    }
+    if(!converged) fprintf(stderr,"nucleus: Newton did not converge in %d steps\n",steps);
+
+    // digits enough to place the nucleus well inside its own size
+    // (a failed Newton can leave any size, so keep it between 10 and what
+    // the precision holds)
+    double want=10.0-size.e*0.30102999566398120, most=10.0+prec*0.30102999566398120;
+    size_t digits=(size_t)(want<10.0 ? 10.0 : want>most ? most : want);
+    printf("re "); mpfr_out_str(stdout,10,digits,cr,MPFR_RNDN); printf("\n");
+    printf("im "); mpfr_out_str(stdout,10,digits,ci,MPFR_RNDN); printf("\n");
+    printf("size "); printFe(size); printf(", angle %.4f\n",angle);
+
+    mpfr_prec_round(d,prec,MPFR_RNDN);
+    mpfr_sub(d,cr,d,MPFR_RNDN);
+    floatexp dx=feFromMpfr(d);
+    mpfr_set_str(d,argv[1],10,MPFR_RNDN);
+    mpfr_sub(d,ci,d,MPFR_RNDN);
+    floatexp dy=feFromMpfr(d);
+    printf("offset from centre: "); printFe(dx); printf(" "); printFe(dy);
+    printf(" (%.3f radii)\n",sqrt(feToDouble(feDiv(feNorm2(dx,dy),feMul(r,r)))));
+    printf("newton: %d steps at %ld bits, %.3fs\n",steps,(long)prec,nowSeconds()-t0);
+    mpfr_clear(cr); mpfr_clear(ci); mpfr_clear(d);
+    return converged ? 0 : 1;
+}
@@ -0,0 +1,276 @@
+// High-precision reference orbits for the deep zoom renderer
+//
+// Each step is three independent products (x^2, y^2, xy) followed by two
+// cheap additions. At high precision the products dominate, so above
+// ORBIT_PARALLEL_BITS two helper threads take y^2 and xy while the caller does
+// x^2; they meet at a spin barrier once per iteration. Points are streamed into
+// geometrically grown double arrays, and the final MPFR z is kept so the orbit
+// can be extended or saved and resumed later instead of recomputed.
+//
+// The cache serves interactive zooming: perturbation only needs the reference
+// somewhere inside the view, so an orbit stays usable while its c is on screen
+// and its precision covers the pixel size, and a deeper zoom into the same
+// point only ever extends it.
+#include "deep.h"
+#include "threads.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ORBIT_PARALLEL_BITS 2048
+#define ORBIT_FILE_MAGIC "FORB1\n"
+
+void refOrbitInit(RefOrbit* o, mpfr_prec_t prec){
+    mpfr_init2(o->cr,prec); mpfr_init2(o->ci,prec);
+    mpfr_init2(o->x,prec); mpfr_init2(o->y,prec);
+    mpfr_set_ui(o->cr,0,MPFR_RNDN); mpfr_set_ui(o->ci,0,MPFR_RNDN);
+    mpfr_set_ui(o->x,0,MPFR_RNDN); mpfr_set_ui(o->y,0,MPFR_RNDN);
+    o->prec=prec;
+    o->zr=o->zi=NULL;
+    o->length=o->capacity=0;
+    o->escaped=0;
+}
+
+void refOrbitFree(RefOrbit* o){
+    mpfr_clear(o->cr); mpfr_clear(o->ci);
+    mpfr_clear(o->x); mpfr_clear(o->y);
+    free(o->zr); free(o->zi);
+    o->zr=o->zi=NULL;
+    o->length=o->capacity=0;
+}
+
+// Room for one more point; 0 when the arrays can't grow, leaving the orbit as it was
+static int reservePoint(RefOrbit* o){
+    if(o->length<o->capacity) return 1;
+    int capacity = !o->capacity ? 4096 : o->capacity>INT_MAX/2 ? INT_MAX : o->capacity*2;
+    double* r=(double*)realloc(o->zr,(size_t)capacity*sizeof(double));
+    if(!r) return 0;
+    o->zr=r;
+    double* i=(double*)realloc(o->zi,(size_t)capacity*sizeof(double));
+    if(!i) return 0;
+    o->zi=i;
+    o->capacity=capacity;
+    return 1;
+}
+
+static void appendPoint(RefOrbit* o, double zr, double zi){
+    o->zr[o->length]=zr; o->zi[o->length]=zi;
+    o->length++;
+    if(zr*zr+zi*zi>DEEP_BAILOUT) o->escaped=1;
+}
+
+// --- Parallel step ---
+typedef struct {
+    mpfr_ptr dst;
+    mpfr_srcptr a, b;           // dst = a*b
+    volatile int go, done;      // generation requested / finished
+    volatile int quit;
+} OrbitHelper;
+
+static THREAD_FUNC(orbitHelper){
+    OrbitHelper* h=(OrbitHelper*)arg;
+    for(int gen=1;;gen++){
+        spinUntil(&h->go,gen);
+        if(h->quit) break;
+        if(h->a==h->b) mpfr_sqr(h->dst,h->a,MPFR_RNDN);
+        else mpfr_mul(h->dst,h->a,h->b,MPFR_RNDN);
+        __sync_synchronize();
+        h->done=gen;
+    }
+    THREAD_RETURN;
+}
+
+int refOrbitExtend(RefOrbit* o, int maxIter){
+    if(o->length==0){
+        if(!reservePoint(o)){ fprintf(stderr,"orbit: out of memory\n"); return -1; }
+        appendPoint(o,mpfr_get_d(o->x,MPFR_RNDN),mpfr_get_d(o->y,MPFR_RNDN));
+    }
+    if(o->escaped || o->length>maxIter) return o->length;
+
+    mpfr_t x2, y2, xy;
+    mpfr_init2(x2,o->prec); mpfr_init2(y2,o->prec); mpfr_init2(xy,o->prec);
+
+    OrbitHelper helpers[2]={{y2,o->y,o->y,0,0,0},{xy,o->x,o->y,0,0,0}};
+    Thread threads[2];
+    int parallel=o->prec>=ORBIT_PARALLEL_BITS && cpuCount()>=3 && maxIter-o->length>=64;
+    if(parallel){
+        if(!threadStart(&threads[0],orbitHelper,&helpers[0])) parallel=0;
+        else if(!threadStart(&threads[1],orbitHelper,&helpers[1])){
+            helpers[0].quit=1; __sync_synchronize(); helpers[0].go=1;
+            threadJoin(threads[0]);
+            parallel=0;
+        }
+    }
+
+    // grow before stepping so x, y never run ahead of the stored points
+    int ok=1;
+    for(int gen=1; o->length<=maxIter && !o->escaped && (ok=reservePoint(o)); gen++){
+        // z = z^2 + c as x^2 - y^2 + cr, 2xy + ci
+        if(parallel){
+            __sync_synchronize();
+            helpers[0].go=gen; helpers[1].go=gen;
+            mpfr_sqr(x2,o->x,MPFR_RNDN);
+            spinUntil(&helpers[0].done,gen);
+            spinUntil(&helpers[1].done,gen);
+        } else {
+            mpfr_sqr(x2,o->x,MPFR_RNDN);
+            mpfr_sqr(y2,o->y,MPFR_RNDN);
+            mpfr_mul(xy,o->x,o->y,MPFR_RNDN);
+        }
+        mpfr_sub(o->x,x2,y2,MPFR_RNDN);
+        mpfr_add(o->x,o->x,o->cr,MPFR_RNDN);
+        mpfr_mul_2ui(o->y,xy,1,MPFR_RNDN);
+        mpfr_add(o->y,o->y,o->ci,MPFR_RNDN);
+        appendPoint(o,mpfr_get_d(o->x,MPFR_RNDN),mpfr_get_d(o->y,MPFR_RNDN));
+    }
+    if(!ok) fprintf(stderr,"orbit: out of memory after %d iterations\n",o->length-1);
+
+    if(parallel){
+        for(int k=0;k<2;k++){ helpers[k].quit=1; __sync_synchronize(); helpers[k].go=helpers[k].done+1; }
+        threadJoin(threads[0]); threadJoin(threads[1]);
+    }
+    mpfr_clear(x2); mpfr_clear(y2); mpfr_clear(xy);
+    return ok ? o->length : -1;
+}
+
+int refOrbitCompute(RefOrbit* o, int maxIter){
+    mpfr_set_ui(o->x,0,MPFR_RNDN); mpfr_set_ui(o->y,0,MPFR_RNDN);
+    o->length=0;
+    o->escaped=0;
+    return refOrbitExtend(o,maxIter);
+}
+
+// --- Checkpoints ---
+// Text header (magic, precision, length, then c and the last z in hex so they
+// round-trip exactly), followed by the raw double arrays
+static void writeMpfr(FILE* f, mpfr_srcptr v){
+    mpfr_out_str(f,16,0,v,MPFR_RNDN);
+    fputc('\n',f);
+}
+
+// A token that fills the whole buffer is longer than any value of this
+// precision can print, so it counts as a bad checkpoint
+static int readMpfr(FILE* f, mpfr_ptr v){
+    size_t size=mpfr_get_prec(v)/4+64;
+    char* buf=(char*)malloc(size);
+    if(!buf) return 0;
+    char format[32];
+    snprintf(format,sizeof(format),"%%%us",(unsigned int)(size-1));
+    int ok=fscanf(f,format,buf)==1 && strlen(buf)<size-1 && mpfr_set_str(v,buf,16,MPFR_RNDN)==0;
+    free(buf);
+    return ok;
+}
+
+int refOrbitSave(const RefOrbit* o, const char* path){
+    FILE* f=fopen(path,"wb");
+    if(!f) return 0;
+    fprintf(f,ORBIT_FILE_MAGIC "%ld %d\n",(long)o->prec,o->length);
+    writeMpfr(f,o->cr); writeMpfr(f,o->ci);
+    writeMpfr(f,o->x); writeMpfr(f,o->y);
+    int ok=fwrite(o->zr,sizeof(double),o->length,f)==(size_t)o->length
+        && fwrite(o->zi,sizeof(double),o->length,f)==(size_t)o->length;
+    return fclose(f)==0 && ok;
+}
+
+// Bytes from the current position to the end of f, -1 if it can't seek
+static long long bytesLeft(FILE* f){
+#ifdef _WIN32
+    long long here=_ftelli64(f), end=-1;
+    if(here>=0 && _fseeki64(f,0,SEEK_END)==0) end=_ftelli64(f);
+    if(here<0 || end<0 || _fseeki64(f,here,SEEK_SET)!=0) return -1;
+#else
+    long long here=(long long)ftello(f), end=-1;
+    if(here>=0 && fseeko(f,0,SEEK_END)==0) end=(long long)ftello(f);
+    if(here<0 || end<0 || fseeko(f,(off_t)here,SEEK_SET)!=0) return -1;
+#endif
+    return end-here;
+}
+
+int refOrbitLoad(RefOrbit* o, const char* path){
+    FILE* f=fopen(path,"rb");
+    if(!f) return 0;
+    char magic[8]={0};
+    long prec; int length;
+    if(fread(magic,1,strlen(ORBIT_FILE_MAGIC),f)!=strlen(ORBIT_FILE_MAGIC) || strcmp(magic,ORBIT_FILE_MAGIC)!=0
+       || fscanf(f,"%ld %d",&prec,&length)!=2 || prec<MPFR_PREC_MIN || prec>MPFR_PREC_MAX || length<1){
+        fclose(f);
+        return 0;
+    }
+    refOrbitInit(o,(mpfr_prec_t)prec);
+    int ok=readMpfr(f,o->cr) && readMpfr(f,o->ci) && readMpfr(f,o->x) && readMpfr(f,o->y) && fgetc(f)=='\n';
+    // the header's length must match the arrays actually behind it
+    ok=ok && bytesLeft(f)==(long long)length*2*(long long)sizeof(double);
+    if(ok){
+        o->capacity=length;
+        o->zr=(double*)malloc((size_t)length*sizeof(double));
+        o->zi=(double*)malloc((size_t)length*sizeof(double));
+        ok=o->zr && o->zi
+            && fread(o->zr,sizeof(double),length,f)==(size_t)length && fread(o->zi,sizeof(double),length,f)==(size_t)length;
+    }
+    if(ok){
+        o->length=length;
+        o->escaped=o->zr[length-1]*o->zr[length-1]+o->zi[length-1]*o->zi[length-1]>DEEP_BAILOUT;
+    }
+    fclose(f);
+    if(!ok) refOrbitFree(o);
+    return ok;
+}
+
+// --- Orbit cache ---
+void orbitCacheInit(OrbitCache* c){
+    memset(c,0,sizeof(*c));
+}
+
+void orbitCacheFree(OrbitCache* c){
+    for(int i=0;i<ORBIT_CACHE_SIZE;i++)
+        if(c->stamp[i]) refOrbitFree(&c->orbit[i]);
+    memset(c,0,sizeof(*c));
+}
+
+// |a - b| <= half, computed at the wider of the two precisions
+static int withinHalf(mpfr_srcptr a, mpfr_srcptr b, floatexp half, mpfr_ptr d){
+    mpfr_sub(d,a,b,MPFR_RNDN);
+    floatexp fd=feFromMpfr(d);
+    fd.m=fd.m<0 ? -fd.m : fd.m;
+    return !feLess(half,fd);
+}
+
+RefOrbit* orbitCacheLookup(OrbitCache* c, mpfr_srcptr cx, mpfr_srcptr cy, floatexp halfW, floatexp halfH,
+                           mpfr_prec_t prec, int maxIter){
+    mpfr_prec_t dprec=mpfr_get_prec(cx)>prec ? mpfr_get_prec(cx) : prec;
+    mpfr_t d;
+    mpfr_init2(d,dprec+64);
+
+    // prefer the longest valid orbit: it escapes last, so fewer pixels rebase
+    int best=-1;
+    for(int i=0;i<ORBIT_CACHE_SIZE;i++){
+        RefOrbit* o=&c->orbit[i];
+        if(!c->stamp[i] || o->prec<prec) continue;
+        if(!withinHalf(o->cr,cx,halfW,d) || !withinHalf(o->ci,cy,halfH,d)) continue;
+        if(best<0 || o->length>c->orbit[best].length) best=i;
+    }
+    mpfr_clear(d);
+
+    int ok=1;
+    if(best>=0){
+        RefOrbit* o=&c->orbit[best];
+        if(!o->escaped && o->length<=maxIter){
+            ok=refOrbitExtend(o,maxIter)>0;
+            c->extends++;
+        } else c->hits++;
+    } else {
+        best=0;
+        for(int i=1;i<ORBIT_CACHE_SIZE;i++)
+            if(c->stamp[i]<c->stamp[best]) best=i;
+        RefOrbit* o=&c->orbit[best];
+        if(c->stamp[best]) refOrbitFree(o);
+        refOrbitInit(o,prec);
+        mpfr_set(o->cr,cx,MPFR_RNDN);
+        mpfr_set(o->ci,cy,MPFR_RNDN);
+        ok=refOrbitCompute(o,maxIter)>0;
+        c->misses++;
+    }
+    c->stamp[best]=++c->clock;
+    return ok ? &c->orbit[best] : NULL;
+}
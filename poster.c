@@ -0,0 +1,190 @@
+// Poster renderer: stills of any size, a tile at a time
+//
+//   fractal.exe poster <shader.frag|kernel> <out.tif|out.png> <WxH> [iterations] [cx cy scale]
+//
+// The image is cut into POSTER_TILE squares rendered one after another, either
+// by a .frag shader into an offscreen framebuffer or by one of the built-in CPU
+// kernels (specialized.c) in doubles, and streamed straight to disk:
+//
+//   .tif   tiled BigTIFF; memory holds one tile whatever the image size
+//   .png   rows in bands POSTER_TILE high; memory holds one band, which grows
+//          with the width (POSTER_TILE*width*3 bytes), so very wide posters
+//          belong in a .tif
+//
+// The view uses the CPU convention: square pixels, scale is the half-height.
+// Each tile gets its own centre and scale so the shaders' float arithmetic only
+// has to span one tile, though float still limits how deep a shader poster can
+// go; the CPU kernels hold up to double precision. FRACTAL_AA=<samples> turns
+// on adaptive antialiasing for shaders (aa.c); FRACTAL_C=<re>,<im> sets the
+// Julia parameter of julia-type shaders and kernels.
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include "kernel.h"
+#include "aa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define POSTER_TILE 512
+
+typedef struct {
+    const BuiltinKernel* kernel;    // CPU kernel, or
+    GLuint program;                 // shader into fbo
+    GLuint fbo, color, vao;
+    ParamsBuffer pb;
+    ShaderParams sp;                // view per tile, the rest fixed
+    int maxIter;
+    KernelParams params;
+    AdaptiveAA aa;
+    int samples;
+    double refined;                 // sum over tiles of the fraction refined
+} PosterRenderer;
+
+// Renders the POSTER_TILE square centred on (tcx, tcy) into rgb, top row first
+static void renderPosterTile(PosterRenderer* r, double tcx, double tcy, double tileScale, unsigned char* rgb){
+    if(r->kernel){
+        View v={POSTER_TILE,POSTER_TILE,tcx,tcy,tileScale};
+        renderKernel(r->kernel->fn,&r->params,&v,r->kernel->power,rgb);
+        return;
+    }
+    glUseProgram(r->program);
+    r->sp.center[0]=(float)tcx; r->sp.center[1]=(float)tcy;
+    r->sp.scale=(float)tileScale;
+    paramsUpdate(&r->pb,&r->sp);
+    if(r->samples>1){
+        r->refined+=aaRender(&r->aa,r->program,r->samples,AA_THRESHOLD);
+        glBindFramebuffer(GL_FRAMEBUFFER,r->aa.accumFBO);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER,r->fbo);
+        glViewport(0,0,POSTER_TILE,POSTER_TILE);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBindVertexArray(r->vao);
+        glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+    }
+
+    // GL rows are bottom-up
+    glPixelStorei(GL_PACK_ALIGNMENT,1);
+    glReadPixels(0,0,POSTER_TILE,POSTER_TILE,GL_RGB,GL_UNSIGNED_BYTE,rgb);
+    unsigned char row[POSTER_TILE*3];
+    for(int y=0;y<POSTER_TILE/2;y++){
+        unsigned char* a=rgb+(size_t)y*POSTER_TILE*3;
+        unsigned char* b=rgb+(size_t)(POSTER_TILE-1-y)*POSTER_TILE*3;
+        memcpy(row,a,sizeof(row)); memcpy(a,b,sizeof(row)); memcpy(b,row,sizeof(row));
+    }
+}
+
+// Shader state and the GL window; nothing to do for CPU kernels
+static void freePosterRenderer(PosterRenderer* r, GLWindow* win){
+    if(!r->program) return;
+    if(r->samples>1) aaFree(&r->aa);
+    glDeleteFramebuffers(1,&r->fbo); glDeleteTextures(1,&r->color); glDeleteProgram(r->program);
+    paramsFree(&r->pb);
+    destroyGLWindow(win);
+}
+
+int posterMain(int argc, char** argv){
+    int width=0, height=0;
+    if(argc<3 || sscanf(argv[2],"%dx%d",&width,&height)!=2){
+        printf("usage: fractal.exe poster <shader.frag|kernel> <out.tif|out.png> <WxH> [iterations] [cx cy scale]\n");
+        return 1;
+    }
+    const char* name=argv[0];
+    const char* out=argv[1];
+    size_t nameLen=strlen(name), outLen=strlen(out);
+    int shader=nameLen>5 && strcmp(name+nameLen-5,".frag")==0;
+    int tiff=outLen>4 && strcmp(out+outLen-4,".tif")==0;
+    int png=outLen>4 && strcmp(out+outLen-4,".png")==0;
+
+    PosterRenderer r={0};
+    r.maxIter = argc>3 ? atoi(argv[3]) : 1000;
+    double cx=-0.5, cy=0.0, scale=1.5;
+    if(!shader){
+        r.kernel=findBuiltinKernel(name);
+        if(r.kernel && r.kernel->julia) cx=0.0;
+    }
+    if(argc>6){ cx=atof(argv[4]); cy=atof(argv[5]); scale=atof(argv[6]); }
+    if(width<1 || height<1 || r.maxIter<1 || scale<=0.0 || (!shader && !r.kernel) || (!tiff && !png)){
+        fprintf(stderr,"poster: bad arguments (a .frag or built-in kernel name, a .tif or .png output)\n");
+        return 1;
+    }
+
+    paramsDefaults(&r.sp);
+    r.sp.maxIter=r.maxIter;
+    GLWindow win;
+    if(shader){
+        char* src=loadFile(name);
+        createGLWindow(&win,"Fractal poster",0);
+        r.program=createProgram(vertexShaderSource,src);
+        free(src);
+        if(!paramsAttach(r.program)){
+            fprintf(stderr,"poster: %s declares no Params block (see fractal.h)\n",name);
+            destroyGLWindow(&win);
+            return 1;
+        }
+        paramsInit(&r.pb);
+        glUseProgram(r.program);
+        r.vao=createQuad();
+        glGenTextures(1,&r.color);
+        glBindTexture(GL_TEXTURE_2D,r.color);
+        glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA8,POSTER_TILE,POSTER_TILE,0,GL_RGBA,GL_UNSIGNED_BYTE,NULL);
+        glGenFramebuffers(1,&r.fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER,r.fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,r.color,0);
+        r.samples=aaSamplesFromEnv();
+        if(r.samples>1 && !aaInit(&r.aa,POSTER_TILE,POSTER_TILE,r.vao)){
+            fprintf(stderr,"poster: no stencil framebuffer, antialiasing off\n");
+            aaFree(&r.aa);
+            r.samples=1;
+        }
+    } else {
+        builtinKernelParams(r.kernel,r.maxIter,&r.params);
+        if(r.sp.paramSet){ r.params.jr=r.sp.param[0]; r.params.ji=r.sp.param[1]; }
+    }
+
+    TiffWriter tw;
+    PngWriter pw;
+    int ok = tiff ? tiffWriterOpen(&tw,out,width,height,POSTER_TILE) : pngWriterOpen(&pw,out,width,height);
+    if(!ok){
+        fprintf(stderr,"poster: cannot write %s\n",out);
+        freePosterRenderer(&r,&win);
+        return 1;
+    }
+
+    int tilesX=(width+POSTER_TILE-1)/POSTER_TILE, tilesY=(height+POSTER_TILE-1)/POSTER_TILE;
+    double pixel=2.0*scale/height;
+    double x0=cx-pixel*width*0.5, y0=cy+scale;
+    double tileScale=pixel*POSTER_TILE*0.5;
+    unsigned char* tile=(unsigned char*)malloc((size_t)POSTER_TILE*POSTER_TILE*3);
+    unsigned char* band = png ? (unsigned char*)malloc((size_t)POSTER_TILE*width*3) : NULL;
+    size_t memory=(size_t)POSTER_TILE*POSTER_TILE*3+(band ? (size_t)POSTER_TILE*width*3 : 0);
+    printf("%dx%d in %dx%d tiles of %d, %.1f MB of image buffers\n",width,height,tilesX,tilesY,POSTER_TILE,memory/1048576.0);
+
+    double t0=nowSeconds();
+    for(int ty=0;ty<tilesY && ok;ty++){
+        int rows=height-ty*POSTER_TILE; if(rows>POSTER_TILE) rows=POSTER_TILE;
+        for(int tx=0;tx<tilesX;tx++){
+            double tcx=x0+(tx+0.5)*POSTER_TILE*pixel;
+            double tcy=y0-(ty+0.5)*POSTER_TILE*pixel;
+            renderPosterTile(&r,tcx,tcy,tileScale,tile);
+            if(tiff) ok&=tiffWriterTile(&tw,tile);
+            else {
+                int cols=width-tx*POSTER_TILE; if(cols>POSTER_TILE) cols=POSTER_TILE;
+                for(int y=0;y<rows;y++)
+                    memcpy(band+((size_t)y*width+(size_t)tx*POSTER_TILE)*3,tile+(size_t)y*POSTER_TILE*3,(size_t)cols*3);
+            }
+        }
+        if(png) ok&=pngWriterRows(&pw,band,rows);
+        double dt=nowSeconds()-t0;
+        printf("\rrow %d/%d, %.1fs, about %.0fs left",ty+1,tilesY,dt,dt/(ty+1)*(tilesY-ty-1));
+        fflush(stdout);
+    }
+    printf("\n");
+    if(r.samples>1) printf("antialiasing: %d samples on %.1f%% of rendered pixels\n",r.samples,100.0*r.refined/(tilesX*tilesY));
+    ok&=tiff ? tiffWriterClose(&tw) : pngWriterClose(&pw);
+    if(!ok) fprintf(stderr,"poster: cannot write %s\n",out);
+
+    free(tile); free(band);
+    freePosterRenderer(&r,&win);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,168 @@
+// Headless CPU raymarcher for menger.frag's SDF
+//
+//   fractal.exe menger <out.png> [WxH] [steps] [scale]
+//
+// Same camera, SDF, normal and shading as menger.frag, so the output matches
+// the shader. The image is split into 8x8 tiles handed out to workers. Each
+// tile first marches one cone covering all of its rays (the coarse pass): as
+// long as the SDF at the cone axis exceeds the cone radius no ray in the tile
+// can hit anything, so the tile's rays start where the cone stopped. Rays are
+// then marched as 8-wide packets (one tile row) until every lane has hit,
+// escaped or run out of steps.
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include "simd.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TILE 8              // tile edge; one packet per tile row
+#define HIT_EPS 0.001f
+#define FAR 20.0f
+#define CAM_Z 4.0f
+#define CAM_ZOOM 1.5f
+
+typedef struct {
+    int width, height, steps;
+    float zoom;             // u_scale
+    unsigned char* rgb;
+    int tilesX, tileCount;
+    volatile int nextTile;
+    long long marchSteps[256], coneSteps[256];
+} Menger;
+
+static vfloat mengerSDF(vfloat px, vfloat py, vfloat pz){
+    const float s=3.0f;
+    vfloat d=vsqrt(px*px+py*py+pz*pz);
+    float inv=1.0f;
+    for(int i=0;i<6;i++){
+        px=vabs(px); py=vabs(py); pz=vabs(pz);
+        vswap(px<py,&px,&py);
+        vswap(px<pz,&px,&pz);
+        vswap(py<pz,&py,&pz);
+        px=s*px-(s-1.0f); py=s*py-(s-1.0f); pz=s*pz-(s-1.0f);
+        inv/=s;
+        d=vmin(d,(vsqrt(px*px+py*py+pz*pz)-1.0f)*inv);
+    }
+    return d;
+}
+
+// Ray direction for uv in [0,1]^2, as cameraDir() plus the u_scale zoom
+static void cameraDir(const Menger* m, float u, float v, float* d){
+    float x=(u-0.5f)*2.0f, y=(v-0.5f)*2.0f;
+    float inv=1.0f/sqrtf(x*x+y*y+CAM_ZOOM*CAM_ZOOM);
+    d[0]=x*inv*m->zoom; d[1]=y*inv*m->zoom; d[2]=-CAM_ZOOM*inv;
+}
+
+// Coarse pass: furthest t every ray of the tile can safely start from
+static float coneStart(Menger* m, int worker, int tx, int ty){
+    float c[3], k[3];
+    float u0=(float)tx/m->width, v0=1.0f-(float)(ty+TILE)/m->height;
+    float u1=(float)(tx+TILE)/m->width, v1=1.0f-(float)ty/m->height;
+    cameraDir(m,(u0+u1)*0.5f,(v0+v1)*0.5f,c);
+
+    // cone radius per unit t: spread of the corner rays around the axis ray
+    float spread=0.0f, maxLen=sqrtf(c[0]*c[0]+c[1]*c[1]+c[2]*c[2]);
+    for(int i=0;i<4;i++){
+        cameraDir(m,i&1?u1:u0,i&2?v1:v0,k);
+        float dx=k[0]-c[0], dy=k[1]-c[1], dz=k[2]-c[2];
+        float s=sqrtf(dx*dx+dy*dy+dz*dz), l=sqrtf(k[0]*k[0]+k[1]*k[1]+k[2]*k[2]);
+        if(s>spread) spread=s;
+        if(l>maxLen) maxLen=l;
+    }
+
+    float t=0.0f;
+    for(int i=0;i<m->steps;i++){
+        float d=mengerSDF(vsplat(c[0]*t),vsplat(c[1]*t),vsplat(c[2]*t+CAM_Z))[0];
+        m->coneSteps[worker]++;
+        float clearance=d-spread*t;
+        if(clearance<HIT_EPS*4.0f || t>FAR) break;
+        t+=clearance/maxLen;
+    }
+    return t;
+}
+
+static void marchPacket(Menger* m, int worker, int px0, int py, float t0, int lanes){
+    vfloat dx, dy, dz;
+    float d[3];
+    float v=1.0f-(py+0.5f)/m->height;
+    for(int i=0;i<SIMD_W;i++){
+        cameraDir(m,(px0+i+0.5f)/m->width,v,d);
+        dx[i]=d[0]; dy[i]=d[1]; dz[i]=d[2];
+    }
+
+    vfloat t=vsplat(t0);
+    vint hit=(vint){0}, active=~hit;
+    for(int i=0;i<m->steps && vany(active);i++){
+        vfloat dist=mengerSDF(dx*t,dy*t,dz*t+CAM_Z);
+        vint h=active&(dist<HIT_EPS);
+        hit|=h;
+        active&=~h;
+        t=vselect(active,t+dist,t);
+        for(int k=0;k<lanes;k++) m->marchSteps[worker]+=active[k]!=0;
+        active&=(t<=FAR);
+    }
+
+    // getNormal(): tetrahedral gradient, 4 SDF packets for the whole row
+    vfloat x=dx*t, y=dy*t, z=dz*t+CAM_Z;
+    const float e=0.001f*0.5773f;
+    vfloat a=mengerSDF(x+e,y-e,z-e), b=mengerSDF(x-e,y-e,z+e);
+    vfloat c=mengerSDF(x-e,y+e,z-e), f=mengerSDF(x+e,y+e,z+e);
+    vfloat nx=a-b-c+f, ny=-a-b+c+f, nz=-a+b-c+f;
+    vfloat inv=1.0f/vsqrt(nx*nx+ny*ny+nz*nz+1e-20f);
+    const float lx=0.6f/1.0488f, ly=0.7f/1.0488f, lz=0.5f/1.0488f;   // normalize(0.6,0.7,0.5)
+    vfloat diff=vmax((nx*lx+ny*ly+nz*lz)*inv,vsplat(0.0f));
+
+    unsigned char* out=m->rgb+((size_t)py*m->width+px0)*3;
+    for(int i=0;i<lanes;i++){
+        if(!hit[i]){ out[i*3]=out[i*3+1]=out[i*3+2]=0; continue; }
+        out[i*3+0]=(unsigned char)fminf((0.2f*diff[i]+0.1f)*255.0f+0.5f,255.0f);
+        out[i*3+1]=(unsigned char)fminf((0.4f*diff[i]+0.1f)*255.0f+0.5f,255.0f);
+        out[i*3+2]=(unsigned char)fminf((0.8f*diff[i]+0.1f)*255.0f+0.5f,255.0f);
+    }
+}
+
+static void mengerWorker(void* ctx, int worker){
+    Menger* m=(Menger*)ctx;
+    for(;;){
+        int tile=atomicFetchAdd(&m->nextTile,1);
+        if(tile>=m->tileCount) return;
+        int tx=(tile%m->tilesX)*TILE, ty=(tile/m->tilesX)*TILE;
+        float t0=coneStart(m,worker,tx,ty);
+        int lanes = tx+TILE<=m->width ? TILE : m->width-tx;
+        for(int y=ty;y<ty+TILE && y<m->height;y++) marchPacket(m,worker,tx,y,t0,lanes);
+    }
+}
+
+int mengerMain(int argc, char** argv){
+    if(argc<1){
+        printf("usage: fractal.exe menger <out.png> [WxH] [steps] [scale]\n");
+        return 1;
+    }
+    Menger* m=(Menger*)calloc(1,sizeof(Menger));
+    m->width=800; m->height=600; m->steps=128; m->zoom=1.0f;
+    if(argc>1) sscanf(argv[1],"%dx%d",&m->width,&m->height);
+    if(argc>2) m->steps=atoi(argv[2]);
+    if(argc>3) m->zoom=(float)atof(argv[3]);
+    if(m->width<1 || m->height<1 || m->steps<1){ fprintf(stderr,"menger: bad arguments\n"); free(m); return 1; }
+
+    m->tilesX=(m->width+TILE-1)/TILE;
+    m->tileCount=m->tilesX*((m->height+TILE-1)/TILE);
+    m->rgb=(unsigned char*)malloc((size_t)m->width*m->height*3);
+
+    int workers=cpuCount(); if(workers>256) workers=256;
+    double t0=nowSeconds();
+    runWorkers(workers,mengerWorker,m);
+    double dt=nowSeconds()-t0;
+
+    long long steps=0, cone=0;
+    for(int i=0;i<workers;i++){ steps+=m->marchSteps[i]; cone+=m->coneSteps[i]; }
+    double pixels=(double)m->width*m->height;
+    printf("%.3fs on %d threads, %.1f steps/ray + %.2f cone steps/ray\n",dt,workers,steps/pixels,cone/pixels);
+
+    int ok=writePNG(argv[0],m->rgb,m->width,m->height);
+    if(!ok) fprintf(stderr,"menger: cannot write %s\n",argv[0]);
+    free(m->rgb); free(m);
+    return ok ? 0 : 1;
+}
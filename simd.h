@@ -0,0 +1,54 @@
+// Fixed-width SIMD packets on GCC vector extensions (SSE/AVX/NEON as available)
+//
+// Packets are only passed by value between static inline helpers, never across
+// translation units (kernels take double arrays), so the -Wpsabi note GCC gives
+// for 32-byte vectors without -mavx is harmless; the build scripts turn it off.
+#ifndef SIMD_H
+#define SIMD_H
+
+#define SIMD_W 8    // lanes per packet
+
+typedef float vfloat __attribute__((vector_size(SIMD_W*sizeof(float))));
+typedef int vint __attribute__((vector_size(SIMD_W*sizeof(int))));
+
+static inline vfloat vsplat(float x){ vfloat v={0}; return v+x; }
+static inline vfloat vselect(vint m, vfloat a, vfloat b){   // m ? a : b
+    return (vfloat)((m&(vint)a)|(~m&(vint)b));
+}
+static inline vfloat vmin(vfloat a, vfloat b){ return vselect(a<b,a,b); }
+static inline vfloat vmax(vfloat a, vfloat b){ return vselect(a>b,a,b); }
+static inline vfloat vabs(vfloat a){ return (vfloat)((vint)a&0x7fffffff); }
+static inline vfloat vsqrt(vfloat a){
+    for(int i=0;i<SIMD_W;i++) a[i]=__builtin_sqrtf(a[i]);
+    return a;
+}
+static inline int vany(vint m){
+    int r=0;
+    for(int i=0;i<SIMD_W;i++) r|=m[i];
+    return r!=0;
+}
+// Conditionally swaps lanes of a and b where m is set
+static inline void vswap(vint m, vfloat* a, vfloat* b){
+    vfloat t=vselect(m,*b,*a);
+    *b=vselect(m,*a,*b);
+    *a=t;
+}
+
+// Double-precision packets for escape-time kernels
+#define SIMD_WD 4
+
+typedef double vdouble __attribute__((vector_size(SIMD_WD*sizeof(double))));
+typedef long long vlong __attribute__((vector_size(SIMD_WD*sizeof(long long))));
+
+static inline vdouble vsplatd(double x){ vdouble v={0}; return v+x; }
+static inline vdouble vselectd(vlong m, vdouble a, vdouble b){
+    return (vdouble)((m&(vlong)a)|(~m&(vlong)b));
+}
+static inline vdouble vabsd(vdouble a){ return (vdouble)((vlong)a&0x7fffffffffffffffLL); }
+static inline int vanyl(vlong m){
+    long long r=0;
+    for(int i=0;i<SIMD_WD;i++) r|=m[i];
+    return r!=0;
+}
+
+#endif
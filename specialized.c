@@ -0,0 +1,127 @@
+// Specialized CPU kernels for the built-in shaders, and the "cpu" still renderer
+//
+//   fractal.exe cpu <mandelbrot|multibrot3|julia|burning_ship|...> <out.png> [WxH] [iterations] [cx cy scale]
+//
+// The built-in formulas are one loop with a few twists: the power, folding
+// components through abs() before or after the power, conjugation, and Julia vs
+// Mandelbrot seeding. iteratePacket() takes those traits as plain int arguments
+// and is forced inline into one small wrapper per shader that passes literal
+// constants, so each wrapper compiles to its own branch-free loop with the
+// power fully unrolled.
+#include "fractal.h"
+#include "kernel.h"
+#include "image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// fold traits
+#define FOLD_NONE 0
+#define FOLD_RE 1           // |Re z| before the power (perpendicular)
+#define FOLD_BOTH 3         // |Re z| + i|Im z| before the power (burning ship)
+#define FOLD_RE_AFTER 4     // |Re z^n| after the power (celtic)
+
+#define ALWAYS_INLINE static inline __attribute__((always_inline))
+
+ALWAYS_INLINE void cpowPacket(vdouble* zr, vdouble* zi, const int power){
+    vdouble r=*zr, i=*zi;
+    for(int k=1;k<power;k++){
+        vdouble t=r**zr-i**zi;
+        i=r**zi+i**zr; r=t;
+    }
+    *zr=r; *zi=i;
+}
+
+ALWAYS_INLINE void iteratePacket(const KernelParams* p, const double* x, const double* y, int* iter, double* r2,
+                                 const int power, const int fold, const int conj, const int julia){
+    vdouble zr, zi, cr, ci;
+    for(int k=0;k<SIMD_WD;k++){
+        if(julia){ zr[k]=x[k]; zi[k]=y[k]; }
+        else { cr[k]=x[k]; ci[k]=y[k]; }
+    }
+    if(julia){ cr=vsplatd(p->jr); ci=vsplatd(p->ji); }
+    else { zr=vsplatd(0.0); zi=zr; }
+
+    vlong count={0}, active=~count;
+    for(int n=0;n<p->maxIter;n++){
+        vdouble wr=zr, wi=zi;
+        if(fold&FOLD_RE) wr=vabsd(wr);
+        if((fold&FOLD_BOTH)==FOLD_BOTH) wi=vabsd(wi);
+        if(conj) wi=-wi;
+        cpowPacket(&wr,&wi,power);
+        if(fold&FOLD_RE_AFTER) wr=vabsd(wr);
+        zr=vselectd(active,wr+cr,zr);
+        zi=vselectd(active,wi+ci,zi);
+        active&=(zr*zr+zi*zi<=p->bailout);
+        count-=active;
+        if(!vanyl(active)) break;
+    }
+    vdouble m=zr*zr+zi*zi;
+    for(int k=0;k<SIMD_WD;k++){ iter[k]=(int)count[k]; r2[k]=m[k]; }
+}
+
+#define SPECIALIZE(name, power, fold, conj, julia) \
+    static void name(const KernelParams* p, const double* x, const double* y, int* iter, double* r2){ \
+        iteratePacket(p,x,y,iter,r2,power,fold,conj,julia); \
+    }
+
+SPECIALIZE(mandelbrotKernel,   2, FOLD_NONE,     0, 0)
+SPECIALIZE(multibrot3Kernel,   3, FOLD_NONE,     0, 0)
+SPECIALIZE(juliaKernel,        2, FOLD_NONE,     0, 1)
+SPECIALIZE(burningShipKernel,  2, FOLD_BOTH,     0, 0)
+SPECIALIZE(tricornKernel,      2, FOLD_NONE,     1, 0)
+SPECIALIZE(celticKernel,       2, FOLD_RE_AFTER, 0, 0)
+SPECIALIZE(perpJuliaKernel,    2, FOLD_RE,       0, 1)
+
+// Julia constants match the ones hard-coded in the shaders
+static const BuiltinKernel builtinKernels[]={
+    {"mandelbrot",          mandelbrotKernel,  2.0, 0,  0.0,   0.0  },
+    {"multibrot3",          multibrot3Kernel,  3.0, 0,  0.0,   0.0  },
+    {"julia",               juliaKernel,       2.0, 1, -0.8,   0.156},
+    {"burning_ship",        burningShipKernel, 2.0, 0,  0.0,   0.0  },
+    {"tricorn",             tricornKernel,     2.0, 0,  0.0,   0.0  },
+    {"celtic_fractal",      celticKernel,      2.0, 0,  0.0,   0.0  },
+    {"perpendicular_julia", perpJuliaKernel,   2.0, 1, -0.4,   0.6  },
+};
+
+const BuiltinKernel* findBuiltinKernel(const char* name){
+    for(size_t k=0;k<sizeof(builtinKernels)/sizeof(builtinKernels[0]);k++){
+        size_t n=strlen(builtinKernels[k].name);
+        if(strncmp(name,builtinKernels[k].name,n)==0 && (name[n]=='\0' || strcmp(name+n,".frag")==0))
+            return &builtinKernels[k];
+    }
+    return NULL;
+}
+
+void builtinKernelParams(const BuiltinKernel* b, int maxIter, KernelParams* p){
+    memset(p,0,sizeof(*p));
+    p->julia=b->julia; p->jr=b->jr; p->ji=b->ji;
+    p->maxIter=maxIter;
+    p->bailout=4.0;
+}
+
+int cpuMain(int argc, char** argv){
+    const BuiltinKernel* b = argc>=2 ? findBuiltinKernel(argv[0]) : NULL;
+    if(!b){
+        printf("usage: fractal.exe cpu <name> <out.png> [WxH] [iterations] [cx cy scale]\n  names:");
+        for(size_t k=0;k<sizeof(builtinKernels)/sizeof(builtinKernels[0]);k++) printf(" %s",builtinKernels[k].name);
+        printf("\n");
+        return 1;
+    }
+    View v={1920,1080, b->julia?0.0:-0.5, 0.0, 1.5};
+    int iter=500;
+    if(argc>2) sscanf(argv[2],"%dx%d",&v.width,&v.height);
+    if(argc>3) iter=atoi(argv[3]);
+    if(argc>6){ v.cx=atof(argv[4]); v.cy=atof(argv[5]); v.scale=atof(argv[6]); }
+    if(v.width<1 || v.height<1 || iter<1){ fprintf(stderr,"cpu: bad arguments\n"); return 1; }
+
+    KernelParams kp;
+    builtinKernelParams(b,iter,&kp);
+    unsigned char* rgb=(unsigned char*)malloc((size_t)v.width*v.height*3);
+    double dt=renderKernel(b->fn,&kp,&v,b->power,rgb);
+    printf("%.3fs (%s kernel)\n",dt,b->name);
+    int ok=writePNG(argv[1],rgb,v.width,v.height);
+    if(!ok) fprintf(stderr,"cpu: cannot write %s\n",argv[1]);
+    free(rgb);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// Minimal thread/lock wrappers (Win32, pthreads) for the worker-based modes
+#ifndef THREADS_H
+#define THREADS_H
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef HANDLE Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE Cond;
+#define THREAD_FUNC(name) DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN return 0
+
+static inline int threadStart(Thread* t, LPTHREAD_START_ROUTINE fn, void* arg){
+    *t=CreateThread(NULL,0,fn,arg,0,NULL);
+    return *t!=NULL;
+}
+static inline void threadJoin(Thread t){ WaitForSingleObject(t,INFINITE); CloseHandle(t); }
+static inline void threadDetach(Thread t){ CloseHandle(t); }
+static inline void threadYield(void){ SwitchToThread(); }
+static inline void sleepMs(int ms){ Sleep((DWORD)ms); }
+
+static inline void mutexInit(Mutex* m){ InitializeCriticalSection(m); }
+static inline void mutexDestroy(Mutex* m){ DeleteCriticalSection(m); }
+static inline void mutexLock(Mutex* m){ EnterCriticalSection(m); }
+static inline void mutexUnlock(Mutex* m){ LeaveCriticalSection(m); }
+
+static inline void condInit(Cond* c){ InitializeConditionVariable(c); }
+static inline void condDestroy(Cond* c){ (void)c; }
+static inline void condWait(Cond* c, Mutex* m){ SleepConditionVariableCS(c,m,INFINITE); }
+static inline void condSignal(Cond* c){ WakeConditionVariable(c); }
+static inline void condBroadcast(Cond* c){ WakeAllConditionVariable(c); }
+
+static inline int cpuCount(void){
+    SYSTEM_INFO si; GetSystemInfo(&si);
+    return si.dwNumberOfProcessors>0 ? (int)si.dwNumberOfProcessors : 1;
+}
+static inline double nowSeconds(void){
+    LARGE_INTEGER f,c; QueryPerformanceFrequency(&f); QueryPerformanceCounter(&c);
+    return (double)c.QuadPart/(double)f.QuadPart;
+}
+
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Cond;
+#define THREAD_FUNC(name) void* name(void* arg)
+#define THREAD_RETURN return NULL
+
+static inline int threadStart(Thread* t, void* (*fn)(void*), void* arg){ return pthread_create(t,NULL,fn,arg)==0; }
+static inline void threadJoin(Thread t){ pthread_join(t,NULL); }
+static inline void threadDetach(Thread t){ pthread_detach(t); }
+static inline void threadYield(void){ sched_yield(); }
+static inline void sleepMs(int ms){ usleep((useconds_t)ms*1000); }
+
+static inline void mutexInit(Mutex* m){ pthread_mutex_init(m,NULL); }
+static inline void mutexDestroy(Mutex* m){ pthread_mutex_destroy(m); }
+static inline void mutexLock(Mutex* m){ pthread_mutex_lock(m); }
+static inline void mutexUnlock(Mutex* m){ pthread_mutex_unlock(m); }
+
+static inline void condInit(Cond* c){ pthread_cond_init(c,NULL); }
+static inline void condDestroy(Cond* c){ pthread_cond_destroy(c); }
+static inline void condWait(Cond* c, Mutex* m){ pthread_cond_wait(c,m); }
+static inline void condSignal(Cond* c){ pthread_cond_signal(c); }
+static inline void condBroadcast(Cond* c){ pthread_cond_broadcast(c); }
+
+static inline int cpuCount(void){
+    long n=sysconf(_SC_NPROCESSORS_ONLN);
+    return n>0 ? (int)n : 1;
+}
+static inline double nowSeconds(void){
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC,&ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+#endif
+
+// --- Worker pools ---
+static inline int atomicFetchAdd(volatile int* p, int v){ return __sync_fetch_and_add(p,v); }
+
+// Busy-waits for *p == v, yielding once the wait gets long
+static inline void spinUntil(volatile int* p, int v){
+    for(int k=0; *p!=v; k++) if(k>1000) threadYield();
+    __sync_synchronize();
+}
+
+typedef void (*WorkerFn)(void* ctx, int worker);
+typedef struct { WorkerFn fn; void* ctx; int worker; } WorkerStart;
+
+static inline THREAD_FUNC(workerTrampoline){
+    WorkerStart* ws=(WorkerStart*)arg;
+    ws->fn(ws->ctx,ws->worker);
+    THREAD_RETURN;
+}
+
+// Runs fn(ctx,0..n-1) on n threads (worker 0 is the caller) and waits for all of them
+static inline void runWorkers(int n, WorkerFn fn, void* ctx){
+    if(n<1) n=1;
+    Thread* threads=(Thread*)malloc(n*sizeof(Thread));
+    WorkerStart* starts=(WorkerStart*)malloc(n*sizeof(WorkerStart));
+    int started=1;
+    for(int i=0;i<n;i++){ starts[i].fn=fn; starts[i].ctx=ctx; starts[i].worker=i; }
+    for(int i=1;i<n;i++){
+        if(!threadStart(&threads[i],workerTrampoline,&starts[i])) break;
+        started++;
+    }
+    fn(ctx,0);
+    for(int i=started;i<n;i++) fn(ctx,i);      // threads we could not start run inline
+    for(int i=1;i<started;i++) threadJoin(threads[i]);
+    free(threads); free(starts);
+}
+
+#endif
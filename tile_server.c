@@ -0,0 +1,507 @@
+// Loopback HTTP tile server: renders z/x/y tiles of any .frag for slippy-map viewers
+//
+//   fractal.exe serve [port] [cacheMB] [iterations]
+//   GET /                          Leaflet viewer (?shader=julia.frag&iter=500&c=-0.4,0.6)
+//   GET /<shader>/<z>/<x>/<y>.png  one 256x256 tile, optional ?iter=N&c=<re>,<im>
+//   GET /stats                     cache / queue counters
+//
+// Connection threads only parse requests and wait; all GL work happens on the
+// main thread, which pops jobs from a priority queue. Requests for a tile that
+// is already queued or rendering join the existing job instead of adding one,
+// and finished tiles live in an LRU cache bounded by bytes. FRACTAL_AA=<samples>
+// antialiases tiles adaptively (aa.c). Every program reads its view from the
+// one Params uniform buffer (fractal.h), so tiles of different shaders, zooms
+// and Julia parameters follow each other without touching the programs;
+// FRACTAL_C=<re>,<im> sets the default c.
+#ifdef _WIN32
+#include <winsock2.h>
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <stdint.h>
+#include <unistd.h>
+typedef int SOCKET;
+typedef uintptr_t UINT_PTR;
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#define SEND_FLAGS MSG_NOSIGNAL   // a closed connection is an error return, not SIGPIPE
+#endif
+#include "fractal.h"
+#include "threads.h"
+#include "image.h"
+#include "aa.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TILE_SIZE 256
+#define MAX_PROGRAMS 64
+#define HASH_BUCKETS 4096
+#define KEY_LEN 340
+
+// --- Shared state (guarded by lock) ---
+typedef struct Blob { int refs; size_t size; unsigned char* data; } Blob;
+
+typedef struct Job {
+    char key[KEY_LEN];
+    char shader[MAX_PATH];
+    int z, x, y, iter;
+    int paramSet; float param[2];   // c= of the request
+    int waiters, done, status, heapIndex;
+    unsigned long seq;
+    Blob* result;
+    struct Job* chain;              // in-flight hash bucket
+} Job;
+
+typedef struct CacheEntry {
+    char key[KEY_LEN];
+    Blob* blob;
+    struct CacheEntry *prev, *next; // LRU list, head = most recent
+    struct CacheEntry* chain;       // hash bucket
+} CacheEntry;
+
+typedef struct {
+    char name[MAX_PATH];
+    GLuint program;
+    int status;                     // 200 ok, 404 missing, 500 compile error
+} TileProgram;
+
+static Mutex lock;
+static Cond workReady, jobDone;
+
+static Job** heap; static int heapCount, heapCap;
+static Job* inflight[HASH_BUCKETS];
+static unsigned long jobSeq;
+
+static CacheEntry* cacheBuckets[HASH_BUCKETS];
+static CacheEntry *lruHead, *lruTail;
+static size_t cacheBytes, cacheBudget;
+
+static unsigned long statHits, statMisses, statCoalesced, statRendered;
+static double statRenderSeconds;
+
+static int defaultIter=256;
+static ShaderParams defaultParams;  // FRACTAL_C
+
+// --- GL state (main thread only) ---
+static TileProgram programs[MAX_PROGRAMS];
+static int programCount;
+static GLuint tileFBO, tileColor, quadVAO;
+static ParamsBuffer tileParams;
+static AdaptiveAA tileAA;
+static int aaSamples=1;
+static unsigned char tilePixels[TILE_SIZE*TILE_SIZE*3];
+
+static unsigned int hashKey(const char* s){
+    unsigned int h=2166136261u;
+    while(*s){ h^=(unsigned char)*s++; h*=16777619u; }
+    return h%HASH_BUCKETS;
+}
+
+static void blobRelease(Blob* b){
+    if(b && --b->refs==0){ free(b->data); free(b); }
+}
+
+// --- Priority queue: most waiters first, then coarser zoom, then oldest ---
+static int jobBefore(Job* a, Job* b){
+    if(a->waiters!=b->waiters) return a->waiters>b->waiters;
+    if(a->z!=b->z) return a->z<b->z;
+    return a->seq<b->seq;
+}
+
+static void heapSwap(int i, int j){
+    Job* t=heap[i]; heap[i]=heap[j]; heap[j]=t;
+    heap[i]->heapIndex=i; heap[j]->heapIndex=j;
+}
+
+static void heapUp(int i){
+    while(i>0 && jobBefore(heap[i],heap[(i-1)/2])){ heapSwap(i,(i-1)/2); i=(i-1)/2; }
+}
+
+static void heapDown(int i){
+    for(;;){
+        int l=2*i+1, r=l+1, best=i;
+        if(l<heapCount && jobBefore(heap[l],heap[best])) best=l;
+        if(r<heapCount && jobBefore(heap[r],heap[best])) best=r;
+        if(best==i) return;
+        heapSwap(i,best); i=best;
+    }
+}
+
+static void heapPush(Job* j){
+    if(heapCount==heapCap){
+        heapCap = heapCap ? heapCap*2 : 64;
+        heap=(Job**)realloc(heap,heapCap*sizeof(Job*));
+    }
+    heap[heapCount]=j; j->heapIndex=heapCount++;
+    heapUp(j->heapIndex);
+}
+
+static Job* heapPop(void){
+    Job* top=heap[0];
+    heapSwap(0,--heapCount);
+    heapDown(0);
+    top->heapIndex=-1;
+    return top;
+}
+
+// --- In-flight jobs, keyed like the cache ---
+static Job* inflightFind(const char* key){
+    for(Job* j=inflight[hashKey(key)]; j; j=j->chain)
+        if(strcmp(j->key,key)==0) return j;
+    return NULL;
+}
+
+static void inflightRemove(Job* job){
+    Job** p=&inflight[hashKey(job->key)];
+    while(*p!=job) p=&(*p)->chain;
+    *p=job->chain;
+}
+
+// --- LRU cache ---
+static void lruUnlink(CacheEntry* e){
+    if(e->prev) e->prev->next=e->next; else lruHead=e->next;
+    if(e->next) e->next->prev=e->prev; else lruTail=e->prev;
+}
+
+static void lruPushFront(CacheEntry* e){
+    e->prev=NULL; e->next=lruHead;
+    if(lruHead) lruHead->prev=e; else lruTail=e;
+    lruHead=e;
+}
+
+static Blob* cacheGet(const char* key){
+    for(CacheEntry* e=cacheBuckets[hashKey(key)]; e; e=e->chain){
+        if(strcmp(e->key,key)==0){
+            lruUnlink(e); lruPushFront(e);
+            return e->blob;
+        }
+    }
+    return NULL;
+}
+
+static void cacheEvict(CacheEntry* e){
+    CacheEntry** p=&cacheBuckets[hashKey(e->key)];
+    while(*p!=e) p=&(*p)->chain;
+    *p=e->chain;
+    lruUnlink(e);
+    cacheBytes-=e->blob->size;
+    blobRelease(e->blob);
+    free(e);
+}
+
+static void cachePut(const char* key, Blob* blob){
+    if(blob->size>cacheBudget) return;
+    while(lruTail && cacheBytes+blob->size>cacheBudget) cacheEvict(lruTail);
+    CacheEntry* e=(CacheEntry*)calloc(1,sizeof(CacheEntry));
+    strcpy(e->key,key);
+    e->blob=blob; blob->refs++;
+    unsigned int h=hashKey(key);
+    e->chain=cacheBuckets[h]; cacheBuckets[h]=e;
+    lruPushFront(e);
+    cacheBytes+=blob->size;
+}
+
+// Returns an HTTP status; on 200 *out holds a reference the caller must release
+static int fetchTile(const char* shader, int z, int x, int y, int iter, int paramSet, const float* param, Blob** out){
+    char key[KEY_LEN];
+    if(paramSet) snprintf(key,sizeof(key),"%s/%d/%d/%d/%d/%.9g,%.9g",shader,z,x,y,iter,param[0],param[1]);
+    else snprintf(key,sizeof(key),"%s/%d/%d/%d/%d",shader,z,x,y,iter);
+
+    mutexLock(&lock);
+    Blob* hit=cacheGet(key);
+    if(hit){
+        hit->refs++; statHits++;
+        mutexUnlock(&lock);
+        *out=hit;
+        return 200;
+    }
+
+    Job* job=inflightFind(key);
+    if(job){
+        job->waiters++; statCoalesced++;
+        if(job->heapIndex>=0) heapUp(job->heapIndex);
+    } else {
+        job=(Job*)calloc(1,sizeof(Job));
+        strcpy(job->key,key);
+        strcpy(job->shader,shader);
+        job->z=z; job->x=x; job->y=y; job->iter=iter;
+        job->paramSet=paramSet; job->param[0]=param[0]; job->param[1]=param[1];
+        job->waiters=1; job->seq=jobSeq++;
+        unsigned int h=hashKey(key);
+        job->chain=inflight[h]; inflight[h]=job;
+        heapPush(job);
+        statMisses++;
+        condSignal(&workReady);
+    }
+
+    while(!job->done) condWait(&jobDone,&lock);
+
+    int status=job->status;
+    *out=job->result;
+    if(*out) (*out)->refs++;
+    if(--job->waiters==0){
+        blobRelease(job->result);
+        free(job);
+    }
+    mutexUnlock(&lock);
+    return status;
+}
+
+// --- Rendering (main thread) ---
+static TileProgram* getProgram(const char* name){
+    for(int i=0;i<programCount;i++)
+        if(strcmp(programs[i].name,name)==0) return &programs[i];
+    if(programCount==MAX_PROGRAMS) return NULL;
+
+    static TileProgram missing={.status=404};
+    char* src=tryLoadFile(name);
+    if(!src) return &missing;               // not cached, the file may appear later
+    TileProgram* tp=&programs[programCount++];
+    strcpy(tp->name,name);
+    char log[1024];
+    tp->program=tryCreateProgram(vertexShaderSource,src,log,sizeof(log));
+    free(src);
+    if(!tp->program){
+        fprintf(stderr,"%s: %s\n",name,log);
+        tp->status=500;
+        return tp;
+    }
+    if(!paramsAttach(tp->program)){
+        fprintf(stderr,"%s: no Params block (see fractal.h)\n",name);
+        glDeleteProgram(tp->program);
+        tp->status=500;
+        return tp;
+    }
+    tp->status=200;
+    return tp;
+}
+
+static int renderTile(Job* job, Blob** out){
+    *out=NULL;
+    TileProgram* tp=getProgram(job->shader);
+    if(!tp) return 503;
+    if(tp->status!=200) return tp->status;
+
+    // z=0 covers [-2.5,1.5]x[-2,2]; tile y grows downwards
+    double tileScale=2.0/(double)(1u<<job->z);
+    double tcx=-2.5+(job->x+0.5)*2.0*tileScale;
+    double tcy= 2.0-(job->y+0.5)*2.0*tileScale;
+
+    ShaderParams sp;
+    memset(&sp,0,sizeof(sp));
+    sp.center[0]=(float)tcx; sp.center[1]=(float)tcy;
+    sp.scale=(float)tileScale;
+    sp.maxIter=job->iter;
+    sp.param[0]=job->param[0]; sp.param[1]=job->param[1];
+    sp.paramSet=job->paramSet;
+    paramsUpdate(&tileParams,&sp);
+    glUseProgram(tp->program);
+    if(aaSamples>1){
+        aaRender(&tileAA,tp->program,aaSamples,AA_THRESHOLD);
+        glBindFramebuffer(GL_FRAMEBUFFER,tileAA.accumFBO);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER,tileFBO);
+        glViewport(0,0,TILE_SIZE,TILE_SIZE);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBindVertexArray(quadVAO);
+        glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_INT,0);
+    }
+
+    // GL rows are bottom-up, PNG rows top-down
+    glPixelStorei(GL_PACK_ALIGNMENT,1);
+    glReadPixels(0,0,TILE_SIZE,TILE_SIZE,GL_RGB,GL_UNSIGNED_BYTE,tilePixels);
+    unsigned char row[TILE_SIZE*3];
+    for(int r=0;r<TILE_SIZE/2;r++){
+        unsigned char* a=tilePixels+r*TILE_SIZE*3;
+        unsigned char* b=tilePixels+(TILE_SIZE-1-r)*TILE_SIZE*3;
+        memcpy(row,a,sizeof(row)); memcpy(a,b,sizeof(row)); memcpy(b,row,sizeof(row));
+    }
+
+    Blob* b=(Blob*)calloc(1,sizeof(Blob));
+    b->data=encodePNG(tilePixels,TILE_SIZE,TILE_SIZE,&b->size);
+    if(!b->data){ free(b); return 500; }
+    b->refs=1;
+    *out=b;
+    return 200;
+}
+
+// --- HTTP ---
+static const char* indexPage =
+    "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>Fractal tiles</title>"
+    "<link rel=\"stylesheet\" href=\"https://unpkg.com/leaflet@1.9.4/dist/leaflet.css\">"
+    "<script src=\"https://unpkg.com/leaflet@1.9.4/dist/leaflet.js\"></script>"
+    "<style>html,body,#map{height:100%;margin:0;background:#000}</style></head>"
+    "<body><div id=\"map\"></div><script>"
+    "var q=new URLSearchParams(location.search),s=q.get('shader')||'mandelbrot.frag',it=q.get('iter'),c=q.get('c');"
+    "var a=[];if(it)a.push('iter='+it);if(c)a.push('c='+c);"
+    "var m=L.map('map',{crs:L.CRS.Simple,minZoom:0,maxZoom:24}).setView([-128,128],1);"
+    "L.tileLayer('/'+s+'/{z}/{x}/{y}.png'+(a.length?'?'+a.join('&'):''),"
+    "{tileSize:256,noWrap:true,bounds:[[-256,0],[0,256]]}).addTo(m);"
+    "</script></body></html>";
+
+static void sendAll(SOCKET s, const char* data, size_t len){
+    while(len>0){
+        int n=send(s,data,len>65536?65536:(int)len,SEND_FLAGS);
+        if(n<=0) return;
+        data+=n; len-=n;
+    }
+}
+
+static void sendResponse(SOCKET s, int status, const char* type, const void* body, size_t len){
+    const char* reason = status==200?"OK" : status==400?"Bad Request" : status==404?"Not Found"
+                       : status==503?"Service Unavailable" : "Internal Server Error";
+    char header[512];
+    int n=snprintf(header,sizeof(header),
+        "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nContent-Length: %u\r\n"
+        "Cache-Control: max-age=3600\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n",
+        status,reason,type,(unsigned int)len);
+    sendAll(s,header,n);
+    sendAll(s,(const char*)body,len);
+}
+
+static void sendText(SOCKET s, int status, const char* text){
+    sendResponse(s,status,"text/plain",text,strlen(text));
+}
+
+static int validShaderName(const char* name){
+    size_t n=strlen(name);
+    if(n<6 || strcmp(name+n-5,".frag")!=0) return 0;
+    return !strchr(name,'/') && !strchr(name,'\\') && !strchr(name,':') && !strstr(name,"..");
+}
+
+static THREAD_FUNC(connectionThread){
+    SOCKET s=(SOCKET)(UINT_PTR)arg;
+    char req[4096]; int len=0;
+    while(len<(int)sizeof(req)-1){
+        int n=recv(s,req+len,sizeof(req)-1-len,0);
+        if(n<=0) break;
+        len+=n; req[len]='\0';
+        if(strstr(req,"\r\n\r\n")) break;
+    }
+    req[len]='\0';
+
+    char path[1024]="";
+    if(sscanf(req,"GET %1023s",path)!=1){ sendText(s,400,"bad request\n"); closesocket(s); THREAD_RETURN; }
+
+    char shader[MAX_PATH]; int z,x,y,iter=defaultIter;
+    int paramSet=defaultParams.paramSet;
+    float param[2]={defaultParams.param[0],defaultParams.param[1]};
+    char* query=strchr(path,'?');
+    if(query){
+        *query++='\0';
+        for(char* q=query;q;q=strchr(q,'&')){
+            if(*q=='&') q++;
+            sscanf(q,"iter=%d",&iter);
+            if(sscanf(q,"c=%f,%f",&param[0],&param[1])==2) paramSet=1;
+        }
+    }
+
+    if(strcmp(path,"/")==0){
+        sendResponse(s,200,"text/html",indexPage,strlen(indexPage));
+    } else if(strcmp(path,"/stats")==0){
+        char text[512];
+        mutexLock(&lock);
+        snprintf(text,sizeof(text),
+            "hits %lu\nmisses %lu\ncoalesced %lu\nrendered %lu\navg_render_ms %.2f\nqueued %d\ncache_bytes %lu/%lu\n",
+            statHits,statMisses,statCoalesced,statRendered,
+            statRendered ? statRenderSeconds*1000.0/statRendered : 0.0,
+            heapCount,(unsigned long)cacheBytes,(unsigned long)cacheBudget);
+        mutexUnlock(&lock);
+        sendText(s,200,text);
+    } else if(sscanf(path,"/%259[^/]/%d/%d/%d.png",shader,&z,&x,&y)==4 && validShaderName(shader)
+              && z>=0 && z<=30 && x>=0 && y>=0 && x<(1<<z) && y<(1<<z)){
+        if(iter<1) iter=1;
+        Blob* tile;
+        int status=fetchTile(shader,z,x,y,iter,paramSet,param,&tile);
+        if(status==200){
+            sendResponse(s,200,"image/png",tile->data,tile->size);
+            mutexLock(&lock); blobRelease(tile); mutexUnlock(&lock);
+        } else {
+            sendText(s,status,status==404?"no such shader\n":"render failed\n");
+        }
+    } else {
+        sendText(s,404,"expected /<shader.frag>/<z>/<x>/<y>.png\n");
+    }
+    closesocket(s);
+    THREAD_RETURN;
+}
+
+static THREAD_FUNC(acceptThread){
+    SOCKET listener=(SOCKET)(UINT_PTR)arg;
+    for(;;){
+        SOCKET s=accept(listener,NULL,NULL);
+        if(s==INVALID_SOCKET) continue;
+        Thread t;
+        if(threadStart(&t,connectionThread,(void*)(UINT_PTR)s)) threadDetach(t);
+        else closesocket(s);
+    }
+    THREAD_RETURN;
+}
+
+// --- Main ---
+int tileServerMain(int argc, char** argv){
+    int port = argc>0 ? atoi(argv[0]) : 8080;
+    int cacheMB = argc>1 ? atoi(argv[1]) : 256;
+    if(argc>2) defaultIter=atoi(argv[2]);
+    paramsDefaults(&defaultParams);
+    cacheBudget=(size_t)cacheMB<<20;
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if(WSAStartup(MAKEWORD(2,2),&wsa)!=0){ fprintf(stderr,"WSAStartup failed\n"); return 1; }
+#endif
+    SOCKET listener=socket(AF_INET,SOCK_STREAM,IPPROTO_TCP);
+    struct sockaddr_in addr={0};
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons((unsigned short)port);
+    addr.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+    if(listener==INVALID_SOCKET || bind(listener,(struct sockaddr*)&addr,sizeof(addr))!=0 || listen(listener,SOMAXCONN)!=0){
+        fprintf(stderr,"cannot listen on 127.0.0.1:%d\n",port);
+        return 1;
+    }
+
+    GLWindow win;
+    createGLWindow(&win,"Fractal tile server",0);
+    quadVAO=createQuad();
+    paramsInit(&tileParams);
+    glGenTextures(1,&tileColor);
+    glBindTexture(GL_TEXTURE_2D,tileColor);
+    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA8,TILE_SIZE,TILE_SIZE,0,GL_RGBA,GL_UNSIGNED_BYTE,NULL);
+    glGenFramebuffers(1,&tileFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER,tileFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,tileColor,0);
+    aaSamples=aaSamplesFromEnv();
+    if(aaSamples>1 && !aaInit(&tileAA,TILE_SIZE,TILE_SIZE,quadVAO)){
+        fprintf(stderr,"no stencil framebuffer, antialiasing off\n");
+        aaFree(&tileAA);
+        aaSamples=1;
+    }
+
+    mutexInit(&lock); condInit(&workReady); condInit(&jobDone);
+    Thread t;
+    threadStart(&t,acceptThread,(void*)(UINT_PTR)listener);
+    printf("Serving tiles on http://127.0.0.1:%d/ (cache %d MB, %d iterations)\n",port,cacheMB,defaultIter);
+
+    mutexLock(&lock);
+    for(;;){
+        while(heapCount==0) condWait(&workReady,&lock);
+        Job* job=heapPop();
+        mutexUnlock(&lock);
+
+        double t0=nowSeconds();
+        Blob* blob;
+        int status=renderTile(job,&blob);
+        double dt=nowSeconds()-t0;
+
+        mutexLock(&lock);
+        job->status=status; job->result=blob; job->done=1;
+        inflightRemove(job);
+        if(blob) cachePut(job->key,blob);
+        statRendered++; statRenderSeconds+=dt;
+        condBroadcast(&jobDone);
+    }
+    return 0;
+}
@@ -1,13 +1,27 @@
 #version 330 core
-uniform vec2 u_center;
-uniform float u_scale;
-uniform int u_maxIter;
+layout(std140) uniform Params {     // ShaderParams in fractal.h
+    vec2 u_center;
+    float u_scale;
+    int u_maxIter;
+    vec2 u_param;       // formula parameter, e.g. the Julia c
+    int u_paramSet;     // 0: keep the shader's own
+    int u_deMode;       // 1: shade by exterior distance estimate
+    int u_histogram;    // 1: palette by the frame's escape-time distribution
+};
 in vec2 uv;
 out vec4 FragColor;
+layout(location=1) out float Mu;    // escape time for histogram coloring, -1 inside
+uniform sampler2D u_cdf;
+
+float palettePos(float mu){
+    if(u_histogram == 0) return mu/float(u_maxIter);
+    return texture(u_cdf, vec2(log(1.0 + max(mu, 0.0))/log(1.0 + float(u_maxIter)), 0.5)).r;
+}
 
 vec3 pal(float t){ return vec3(t*t, t, 1.0 - t*t); }
 
 void main(){
+    Mu = -1.0;
     vec2 c = (uv - vec2(0.5))*u_scale*2.0 + u_center;
     vec2 z = vec2(0.0);
     int i;
@@ -21,7 +35,8 @@ void main(){
     if(i==u_maxIter) FragColor = vec4(0.0);
     else {
         float mu = float(i) + 1.0 - log(log(length(z)))/log(2.0);
-        FragColor = vec4(pal(mu/float(u_maxIter)),1.0);
+        Mu = mu;
+        FragColor = vec4(pal(palettePos(mu)),1.0);
     }
 }
 